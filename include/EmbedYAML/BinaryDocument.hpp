@@ -0,0 +1,155 @@
+#pragma once
+
+#include <EmbedYAML/YAMLNode.hpp>
+#include <EmbedYAML/YAMLResult.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Precompiled documents hold a parsed tree as a node table and a string pool that refer
+// to each other by offset only, so they can be used in place from flash or a mapped file.
+//
+// Layout, all fields little-endian:
+//   header       32 bytes, see BinaryDocument::HEADER_SIZE
+//   node table   16 bytes per node, the root first and the children of a collection contiguous
+//   string pool  keys and scalars, deduplicated and each followed by a NUL
+//
+// Aliases refer to the children of their anchor instead of repeating them.
+
+enum class BinaryError {
+    None,
+    Truncated,          // Shorter than its header or the sizes it records
+    BadMagic,
+    UnsupportedVersion,
+    ChecksumMismatch,
+    Corrupt,            // A record refers outside the document
+    TooLarge            // The tree does not fit the 32-bit offsets
+};
+
+class BinaryDocument;
+
+// Read-only view of a node in a BinaryDocument, cheap to copy. Lookups that miss return an
+// invalid ref rather than throwing, so chains such as doc.root()["a"]["b"] are always safe.
+class NodeRef {
+public:
+    NodeRef() = default;
+
+    bool valid() const { return m_document != nullptr; }
+    explicit operator bool() const { return valid(); }
+
+    YAMLNode::Kind getKind() const;
+    bool isScalar() const { return valid() && getKind() == YAMLNode::Kind::Scalar; }
+    bool isMapping() const { return valid() && getKind() == YAMLNode::Kind::Mapping; }
+    bool isSequence() const { return valid() && getKind() == YAMLNode::Kind::Sequence; }
+
+    std::string_view getKey() const;
+
+    // Scalar text, NUL-terminated in the document, empty for collections
+    std::string_view asScalar() const;
+
+    // Entries of a mapping or items of a sequence, zero for scalars
+    size_t size() const;
+
+    NodeRef operator[](size_t index) const;
+
+    // Looks through the entries and then the "<<" merge sources, like YAMLNode
+    NodeRef operator[](std::string_view key) const { return find(key); }
+    NodeRef find(std::string_view key) const;
+
+    template <typename T>
+    YAMLResult<T> tryAs() const {
+        if (!isScalar()) {
+            return YAMLValueError::NotScalar;
+        }
+        return YAMLResult<T>::parse(asScalar());
+    }
+
+    template <typename T>
+    T valueOr(std::string_view key, T fallback) const {
+        return find(key).template tryAs<T>().valueOr(std::move(fallback));
+    }
+
+private:
+    friend class BinaryDocument;
+
+    NodeRef(const BinaryDocument* document, uint32_t index) : m_document(document), m_index(index) {}
+
+    NodeRef findEntry(std::string_view key, unsigned depth, unsigned& budget) const;
+
+    const BinaryDocument* m_document = nullptr;
+    uint32_t m_index = 0;
+};
+
+// A precompiled document used in place, loading checks it and allocates nothing
+class BinaryDocument {
+public:
+    static constexpr uint16_t VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 32;
+    static constexpr size_t RECORD_SIZE = 16;
+
+    // Header fields, 32-bit unless noted
+    static constexpr size_t MAGIC = 0;          // "EYBD"
+    static constexpr size_t VERSION_FIELD = 4;  // 16-bit, followed by two reserved bytes
+    static constexpr size_t TOTAL_SIZE = 8;
+    static constexpr size_t CHECKSUM = 12;      // CRC-32 of the document without this field
+    static constexpr size_t NODE_COUNT = 16;
+    static constexpr size_t NODE_OFFSET = 20;
+    static constexpr size_t STRING_OFFSET = 24;
+    static constexpr size_t STRING_BYTES = 28;
+
+    constexpr BinaryDocument() = default;
+
+    // Checks the header, the checksum and every record. The data must stay valid and
+    // unchanged for as long as the document or its refs are used.
+    BinaryError load(const void* data, size_t size);
+
+    // Uses a document known to be valid without checking it, such as one generated by
+    // embedyaml_compile(). Usable in constant expressions, so the document needs no startup code.
+    static constexpr BinaryDocument trusted(const unsigned char* data) {
+        BinaryDocument document;
+        document.m_data = data;
+        document.m_nodes = data + read32(data + NODE_OFFSET);
+        document.m_strings = data + read32(data + STRING_OFFSET);
+        document.m_node_count = read32(data + NODE_COUNT);
+        return document;
+    }
+
+    constexpr bool loaded() const { return m_data != nullptr; }
+
+    // Invalid until a document is loaded
+    NodeRef root() const;
+
+    constexpr size_t nodeCount() const { return m_node_count; }
+
+    // Serializes a parsed tree, out is replaced with the document
+    static BinaryError write(const YAMLNode& root, std::vector<unsigned char>& out);
+
+private:
+    friend class NodeRef;
+
+    // Fields of a node record
+    struct Record {
+        uint32_t key;       // String pool offset of the key
+        uint32_t info;      // Kind in the top two bits, key length below
+        uint32_t data;      // Scalar: string pool offset, collection: index of the first child
+        uint32_t size;      // Scalar: length in bytes, collection: number of children
+    };
+
+    // Byte-wise so documents need no alignment and read the same on any host
+    static constexpr uint32_t read32(const unsigned char* p) {
+        return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    Record record(uint32_t index) const;
+    std::string_view string(uint32_t offset, uint32_t length) const;
+
+    const unsigned char* m_data = nullptr;
+    const unsigned char* m_nodes = nullptr;
+    const unsigned char* m_strings = nullptr;
+    uint32_t m_node_count = 0;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Receives the next block of output, a negative return value stops the writer
+using EYWriteBlockFunction = std::function<int(const char* data, size_t length)>;
+
+// Collects output in a buffer of fixed size and hands it to a write callback in blocks of
+// exactly that size, so writers use the same memory however much they produce. Once a write
+// fails all later output is dropped.
+class BlockWriter {
+public:
+    // Allocates a buffer of buffer_size bytes
+    explicit BlockWriter(EYWriteBlockFunction write, size_t buffer_size = 4096);
+
+    // Uses a caller-owned buffer, which must not be empty and must outlive the writer
+    BlockWriter(EYWriteBlockFunction write, char* buffer, size_t buffer_size);
+
+    BlockWriter(const BlockWriter&) = delete;
+    BlockWriter& operator=(const BlockWriter&) = delete;
+
+    void put(std::string_view text) {
+        if (text.size() < m_capacity - m_used) {
+            std::memcpy(m_buffer + m_used, text.data(), text.size());
+            m_used += text.size();
+        } else {
+            putBlocks(text);
+        }
+    }
+
+    void put(char c) {
+        put(std::string_view(&c, 1));
+    }
+
+    // Hands over the output still buffered as a last, shorter block. Nothing is written on
+    // destruction, so output is only complete once this succeeds.
+    bool flush();
+
+    bool failed() const { return m_failed; }
+
+private:
+    void putBlocks(std::string_view text);
+    void writeBlock();
+
+    EYWriteBlockFunction m_write;
+    std::vector<char> m_owned;
+    char* m_buffer;
+    size_t m_capacity;
+    size_t m_used = 0;
+    bool m_failed = false;
+};
+
+} // namespace EmbedYAML
@@ -1,7 +1,16 @@
 #pragma once
 
+#include <EmbedYAML/BlockWriter.hpp>
+#include <EmbedYAML/Exceptions.hpp>
+#include <EmbedYAML/ParseLimits.hpp>
+#include <EmbedYAML/Reflect.hpp>
+#include <EmbedYAML/Schema.hpp>
+#include <EmbedYAML/YAMLAllocator.hpp>
 #include <EmbedYAML/YAMLNode.hpp>
+#include <EmbedYAML/YAMLStream.hpp>
 #include <functional>
+#include <memory>
+#include <new>
 #include <optional>
 #include <vector>
 #include <string>
@@ -11,23 +20,188 @@
 namespace EmbedYAML {
 
 class EmbedYAML;
+class Transcoder;
+class YAMLTreeBuilder;
 
 using EYFileOpenFunction = std::function<int(EmbedYAML*, std::string)>;
 using EYFileCloseFunction = std::function<int(EmbedYAML*, std::string)>;
 using EYReadCharFunction = std::function<std::optional<char>(EmbedYAML*)>;
+using EYReadBlockFunction = std::function<size_t(EmbedYAML*, char* buffer, size_t size)>;
+
+struct ParseOptions {
+    // Split a root block mapping at its top-level keys and parse the slices concurrently,
+    // falling back to a sequential parse when the input cannot be split safely
+    bool parallel_split = false;
+
+    // Worker threads for parallel parsing, zero picks the hardware concurrency
+    unsigned threads = 0;
+
+    // Inputs smaller than this are always parsed sequentially
+    size_t parallel_min_bytes = 1 << 20;
+
+    // Run libyaml on a second thread that feeds the tree builder through a lock-free
+    // ring, the read callback is then invoked from that thread
+    bool pipelined = false;
+
+    // Events buffered between the two pipeline threads
+    size_t pipeline_capacity = 4096;
+
+    // Build plain block-style documents with the built-in scanner and only hand
+    // input using other syntax to libyaml
+    bool native_scanner = false;
+
+    // Applied to every parse, streams apply them to each item or document in turn
+    ParseLimits limits;
+
+    // Checked by parseFile() and parseBuffer() while the document is built, so a document
+    // breaking it stops with SchemaViolation at the first bad node. Turns parallel_split off,
+    // since the slices of a mapping cannot be checked on their own.
+    std::shared_ptr<const Schema> schema;
+};
+
+// Binary encodings written by transcodeCompactFile() and read by decodeCompactBuffer()
+enum class CompactFormat {
+    CBOR,           // RFC 8949, a stream of documents is a CBOR sequence
+    MessagePack
+};
 
 class EmbedYAML {
 public:
     EmbedYAML(EYFileOpenFunction open, EYFileCloseFunction close, EYReadCharFunction read_char, void* user_context = nullptr);
     ~EmbedYAML();
 
+    // Builds the first document only, see parseDocuments() for multi-document streams
     YAMLNode parseFile(std::string filename);
 
+    // Builds the first document from an in-memory or memory-mapped buffer, which must stay
+    // valid for the call. UTF-16 input with a byte order mark is transcoded to UTF-8 first.
+    // Like parseFile(), it only splits the input when ParseOptions::parallel_split is set.
+    YAMLNode parseBuffer(const char* data, size_t length);
+
+    // Fills a struct declared with EMBEDYAML_REFLECT straight from the parser events of the
+    // first document, without building a tree. Keys without a field are skipped, fields
+    // without a key keep their value. Returns false and sets getLastError() on failure.
+    template <typename T>
+    bool bindFile(std::string filename, T& out) {
+        m_last_error = ParseError::None;
+        m_allocation_stats = AllocationStats();
+
+        EMBEDYAML_TRY {
+            YAMLEventReader reader(this, std::move(filename), &m_allocation_stats);
+            if (!reader.isOpen()) {
+                m_last_error = reader.error() != ParseError::None ? reader.error() : ParseError::OpenFailed;
+                return false;
+            }
+            m_last_error = bindDocument(reader, out, m_parse_options.limits);
+        } EMBEDYAML_CATCH(const std::bad_alloc&) {
+            m_last_error = ParseError::OutOfMemory;
+        }
+        return m_last_error == ParseError::None;
+    }
+
+    // As bindFile(), reading a buffer that must stay valid for the call
+    template <typename T>
+    bool bindBuffer(const char* data, size_t length, T& out) {
+        m_last_error = ParseError::None;
+        m_allocation_stats = AllocationStats();
+
+        size_t max_bytes = m_parse_options.limits.max_input_bytes;
+        if (max_bytes && length > max_bytes) {
+            m_last_error = ParseError::InputTooLarge;
+            return false;
+        }
+
+        EMBEDYAML_TRY {
+            YAMLEventReader reader(data, length, &m_allocation_stats);
+            if (!reader.isOpen()) {
+                m_last_error = ParseError::OutOfMemory;
+                return false;
+            }
+            m_last_error = bindDocument(reader, out, m_parse_options.limits);
+        } EMBEDYAML_CATCH(const std::bad_alloc&) {
+            m_last_error = ParseError::OutOfMemory;
+        }
+        return m_last_error == ParseError::None;
+    }
+
+    // Writes every document of the stream to out as compact JSON, one line each, straight from
+    // the parser events without building a tree. Only anchored nodes are held on to, for their
+    // aliases to be written out in full. Output is flushed on success, on failure what was
+    // written so far is left in out. Returns false and sets getLastError() on failure.
+    bool transcodeJsonFile(std::string filename, BlockWriter& out);
+
+    // As transcodeJsonFile(), reading a buffer that must stay valid for the call
+    bool transcodeJsonBuffer(const char* data, size_t length, BlockWriter& out);
+
+    // Writes every document of the stream to out as one CBOR data item or MessagePack object,
+    // typing scalars and writing aliases like transcodeJsonFile(). CBOR collections have
+    // indefinite length, so CBOR takes a single pass. MessagePack records sizes up front, so
+    // the input is parsed twice and one count per collection is kept in between.
+    bool transcodeCompactFile(std::string filename, CompactFormat format, BlockWriter& out);
+
+    // As transcodeCompactFile(), reading a buffer that must stay valid for the call
+    bool transcodeCompactBuffer(const char* data, size_t length, CompactFormat format, BlockWriter& out);
+
+    // Builds the first item of a compact buffer into a tree like parseBuffer(), which
+    // BinaryDocument::write() turns into a document view. Numbers, booleans and null become
+    // their YAML text, byte strings base64 text, and CBOR tags are dropped. used, when given,
+    // receives the length of the item, so a stream of documents can be read one by one.
+    // The limits apply, and an empty root is returned on failure.
+    YAMLNode decodeCompactBuffer(const char* data, size_t length, CompactFormat format, size_t* used = nullptr);
+
+    // Yields the items of a top-level sequence one at a time, an empty key selects the document root
+    YAMLSequenceStream streamSequence(std::string filename, std::string key = "");
+
+    // Yields the root of every document in a stream, each built and released in turn
+    YAMLDocumentStream parseDocuments(std::string filename);
+
+    // Splits the stream at document markers and parses documents on a thread pool,
+    // zero threads picks the hardware concurrency
+    YAMLParallelDocumentStream parseDocumentsParallel(std::string filename, unsigned threads = 0);
+
+    // Reads files up to size bytes at a time instead of through read_char, returning the
+    // bytes read and zero at the end
+    void setReadBlockFunction(EYReadBlockFunction read_block) { m_read_block_function = std::move(read_block); }
+
+    void setParseOptions(const ParseOptions& options) { m_parse_options = options; }
+    const ParseOptions& getParseOptions() const { return m_parse_options; }
+
+    // Outcome of the last parse, bind or transcode call, streams report through error().
+    // An exhausted heap or StaticPool ends a parse with OutOfMemory and an empty root.
+    ParseError getLastError() const { return m_last_error; }
+
+    // What the last parseFile() or parseBuffer() call found wrong with ParseOptions::schema
+    const SchemaReport& getLastSchemaReport() const { return m_schema_report; }
+
+    // libyaml allocations made by the last parseFile() or parseBuffer() call, across all the
+    // threads it used. Slices of a parallel split add their peaks, so the peak is an upper bound.
+    const AllocationStats& getLastAllocationStats() const { return m_allocation_stats; }
+
     void* getUserContext() const { return m_user_context; }
 private:
+    friend class YAMLEventReader;
+
+    static int readHandler(void* ext, unsigned char* buffer, size_t size, size_t* length);
+
+    YAMLNode parseSource(const std::string& filename);
+    bool readFile(const std::string& filename, std::string& out);
+    bool transcodeCompact(const std::function<std::unique_ptr<YAMLEventReader>()>& open, CompactFormat format,
+                          BlockWriter& out);
+    bool openedReader(const YAMLEventReader& reader);
+    bool transcode(Transcoder& transcoder, YAMLEventReader& reader, BlockWriter& out);
+    YAMLNode parseInput(const char* data, size_t length);
+    bool buildBufferRoot(const char* data, size_t length, YAMLTreeBuilder& builder, YAMLNode& root, bool validated,
+                         AllocationStats& stats);
+
     EYFileOpenFunction m_file_open_function;
     EYFileCloseFunction m_file_close_function;
     EYReadCharFunction m_read_char_function;
+    EYReadBlockFunction m_read_block_function;
+
+    ParseOptions m_parse_options;
+    ParseError m_last_error = ParseError::None;
+    SchemaReport m_schema_report;
+    AllocationStats m_allocation_stats;
 
     // Allow user context variable
     void* m_user_context;
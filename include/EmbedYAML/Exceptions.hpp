@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdlib>
+
+// The library builds with or without exceptions. Without them the bad_alloc handlers
+// compile away, so only allocations made through libyaml or a StaticPool are reported as
+// ParseError::OutOfMemory, and the throwing YAMLNode accessors abort instead.
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+#define EMBEDYAML_EXCEPTIONS 1
+#define EMBEDYAML_TRY try
+#define EMBEDYAML_CATCH(declaration) catch (declaration)
+#define EMBEDYAML_RETHROW throw
+#define EMBEDYAML_THROW(exception) throw exception
+#else
+#define EMBEDYAML_EXCEPTIONS 0
+#define EMBEDYAML_TRY if (true)
+#define EMBEDYAML_CATCH(declaration) if (false)
+#define EMBEDYAML_RETHROW
+#define EMBEDYAML_THROW(exception) std::abort()
+#endif
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <EmbedYAML/KeyHash.hpp>
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cstddef>
+#include <string_view>
+
+namespace EmbedYAML {
+
+// One key of a dotted path with its hash
+struct PathSegment {
+    uint32_t hash = 0;
+    std::string_view key;
+};
+
+constexpr size_t pathSegmentCount(std::string_view path)
+{
+    size_t count = 1;
+    for (char c : path) {
+        if (c == '.')
+            count++;
+    }
+    return count;
+}
+
+// A dotted path of mapping keys such as "sensors.imu.rate", split and hashed at compile
+// time. The text has to outlive the path, which holds for the literals it is built from.
+template <size_t N>
+struct HashedPath {
+    PathSegment segments[N];
+
+    constexpr explicit HashedPath(std::string_view path)
+        : segments{}
+    {
+        size_t start = 0;
+        for (size_t i = 0; i < N; ++i) {
+            size_t end = path.find('.', start);
+            if (end == std::string_view::npos)
+                end = path.size();
+
+            segments[i].key = path.substr(start, end - start);
+            segments[i].hash = keyHash(segments[i].key);
+            start = end + 1;
+        }
+    }
+};
+
+// The node at path below root, null as soon as a key is missing. Every step compares the
+// hashes stored in the nodes and checks the key text only on a match.
+template <size_t N>
+const YAMLNode* get(const YAMLNode& root, const HashedPath<N>& path)
+{
+    const YAMLNode* node = &root;
+    for (const auto& segment : path.segments) {
+        node = node->findHashed(segment.hash, segment.key);
+        if (!node)
+            return nullptr;
+    }
+    return node;
+}
+
+template <size_t N, typename T>
+T valueOr(const YAMLNode& root, const HashedPath<N>& path, T fallback)
+{
+    const YAMLNode* node = get(root, path);
+    return node ? node->tryAs<T>().valueOr(std::move(fallback)) : fallback;
+}
+
+} // namespace EmbedYAML
+
+// A HashedPath from a string literal, hashed at compile time in C++17 as well:
+//   EmbedYAML::get(root, EMBEDYAML_PATH("sensors.imu.rate"))
+#define EMBEDYAML_PATH(text)                                                                                    \
+    ([] {                                                                                                       \
+        constexpr ::EmbedYAML::HashedPath<::EmbedYAML::pathSegmentCount(text)> path(text);                       \
+        return path;                                                                                            \
+    }())
+
+#if defined(__cpp_nontype_template_args) && __cpp_nontype_template_args >= 201911L
+
+namespace EmbedYAML {
+
+// String literal usable as a template argument
+template <size_t N>
+struct PathLiteral {
+    char text[N] = {};
+
+    constexpr PathLiteral(const char (&literal)[N])
+    {
+        for (size_t i = 0; i < N; ++i)
+            text[i] = literal[i];
+    }
+
+    constexpr std::string_view view() const { return std::string_view(text, N - 1); }
+};
+
+// C++20 spelling of get() and valueOr(), e.g. EmbedYAML::get<"sensors.imu.rate">(root)
+template <PathLiteral P>
+const YAMLNode* get(const YAMLNode& root)
+{
+    static constexpr HashedPath<pathSegmentCount(P.view())> path(P.view());
+    return get(root, path);
+}
+
+template <PathLiteral P, typename T>
+T valueOr(const YAMLNode& root, T fallback)
+{
+    static constexpr HashedPath<pathSegmentCount(P.view())> path(P.view());
+    return valueOr(root, path, std::move(fallback));
+}
+
+} // namespace EmbedYAML
+
+#endif
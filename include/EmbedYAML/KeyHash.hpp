@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace EmbedYAML {
+
+// 32-bit FNV-1a of a mapping key, stored in every YAMLNode as it is built and
+// evaluated at compile time for hashed paths
+constexpr uint32_t keyHash(std::string_view key)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : key) {
+        hash ^= (unsigned char)c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace EmbedYAML {
+
+// Read-only mapping of a whole file, for loading a BinaryDocument in place on hosts with
+// mmap. Elsewhere open() fails and documents are loaded from memory-mapped flash directly.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Replaces any file mapped before, false when it cannot be opened or is empty
+    bool open(const std::string& filename);
+    void close();
+
+    const void* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    void* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace EmbedYAML {
+
+// Bounds for parsing untrusted input, zero leaves a bound unchecked. Parsing stops at
+// the first bound exceeded and the partial tree built up to that point is returned.
+struct ParseLimits {
+    // Nesting of mappings and sequences
+    size_t max_depth = 0;
+
+    // Scalars, collections and aliases, mapping keys included
+    size_t max_nodes = 0;
+
+    // Scalar text across a document, mapping keys included
+    size_t max_scalar_bytes = 0;
+
+    // Nodes reachable through aliases, counted as if every alias were a full copy
+    size_t max_alias_expansions = 0;
+
+    // Bytes read from the source
+    size_t max_input_bytes = 0;
+};
+
+enum class ParseError {
+    None,
+    OpenFailed,
+    Syntax,
+    InputTooLarge,
+    TooDeep,
+    TooManyNodes,
+    ScalarBytesExceeded,
+    AliasExpansionsExceeded,
+    OutOfMemory,
+    TypeMismatch,       // Binding found a node that does not fit the field it maps to
+    Unsupported,        // Binding met an alias, which needs the tree to resolve, or a transcoded key was a collection
+    SchemaViolation,    // The document broke ParseOptions::schema, see getLastSchemaReport()
+    WriteFailed         // The write callback of a transcoder returned a negative value
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <EmbedYAML/BinaryDocument.hpp>
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+// A lookup expression such as "devices[12].channels.gain", parsed and hashed once so it can
+// be applied to many documents. Keys are separated by dots and [n] selects the nth child.
+class Path {
+public:
+    struct Step {
+        std::string key;        // Empty for an index step
+        uint32_t hash = 0;      // keyHash() of the key
+        size_t index = 0;
+        bool is_index = false;
+    };
+
+    Path() = default;
+
+    // Leaves the path invalid when the expression is malformed, e.g. "a..b" or "a[x]"
+    explicit Path(std::string_view expression);
+
+    bool valid() const { return m_valid; }
+    const std::vector<Step>& steps() const { return m_steps; }
+
+    // The node the path leads to from root, null when it is invalid or any step misses
+    const YAMLNode* find(const YAMLNode& root) const;
+    NodeRef find(NodeRef root) const;
+
+private:
+    std::vector<Step> m_steps;
+    bool m_valid = false;
+};
+
+// A Path applied to the same document repeatedly, remembering which child each step took.
+// A later resolve() only confirms those positions and searches again from the first one
+// that no longer holds the expected key.
+class Query {
+public:
+    explicit Query(Path path);
+
+    const Path& path() const { return m_path; }
+
+    // Safe after any change to the document, costs a few comparisons per step while the
+    // positions still hold
+    const YAMLNode* resolve(const YAMLNode& root);
+
+    // Returns the cached result without touching the document while root and generation
+    // match the last call. The owner of the document changes generation whenever it
+    // modifies or replaces it.
+    const YAMLNode* resolve(const YAMLNode& root, uint64_t generation);
+
+    void invalidate();
+
+private:
+    // Position of a step not resolved yet or found through a "<<" merge, searched for every time
+    static constexpr size_t UNRESOLVED = SIZE_MAX;
+
+    Path m_path;
+    std::vector<size_t> m_positions;
+    const YAMLNode* m_root = nullptr;
+    const YAMLNode* m_result = nullptr;
+    uint64_t m_generation = 0;
+    bool m_cached = false;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <EmbedYAML/KeyHash.hpp>
+#include <EmbedYAML/ParseLimits.hpp>
+#include <EmbedYAML/YAMLResult.hpp>
+#include <EmbedYAML/YAMLStream.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+#include <yaml.h>
+
+namespace EmbedYAML {
+
+// Maps the fields of a struct to mapping keys of the same name, declared for a type with
+// EMBEDYAML_REFLECT. Binding then fills the struct straight from parser events.
+template <typename T, typename = void>
+struct Reflect {
+    static constexpr bool defined = false;
+};
+
+namespace detail {
+
+template <typename T>
+struct IsVector : std::false_type {};
+
+template <typename T>
+struct IsVector<std::vector<T>> : std::true_type {};
+
+template <typename T>
+struct IsOptional : std::false_type {};
+
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+inline std::string_view scalarText(const yaml_event_t& event)
+{
+    return std::string_view((const char*)event.data.scalar.value, event.data.scalar.length);
+}
+
+// Plain "", "~" and "null" in any of its YAML 1.2 core spellings
+inline bool isNull(const yaml_event_t& event)
+{
+    if (event.type != YAML_SCALAR_EVENT || event.data.scalar.style != YAML_PLAIN_SCALAR_STYLE)
+        return false;
+
+    std::string_view text = scalarText(event);
+    return text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL";
+}
+
+inline ParseError failure(const YAMLEventReader& reader)
+{
+    return reader.error() != ParseError::None ? reader.error() : ParseError::Syntax;
+}
+
+inline ParseError advance(YAMLEventReader& reader)
+{
+    return reader.next() ? ParseError::None : failure(reader);
+}
+
+inline ParseError skip(YAMLEventReader& reader)
+{
+    return reader.skipNode() ? ParseError::None : failure(reader);
+}
+
+// Nodes and scalar text bound so far, checked against the limits as every node is read.
+// Skipped keys and values are not counted since nothing is kept of them.
+struct BindCounter {
+    const ParseLimits& limits;
+    size_t nodes = 0;
+    size_t scalar_bytes = 0;
+
+    ParseError count(const yaml_event_t& event)
+    {
+        if (limits.max_nodes && ++nodes > limits.max_nodes)
+            return ParseError::TooManyNodes;
+        if (event.type == YAML_SCALAR_EVENT) {
+            scalar_bytes += event.data.scalar.length;
+            if (limits.max_scalar_bytes && scalar_bytes > limits.max_scalar_bytes)
+                return ParseError::ScalarBytesExceeded;
+        }
+        return ParseError::None;
+    }
+};
+
+} // namespace detail
+
+// Fills out from the node starting at the current event, leaving its last event current.
+// A null leaves out untouched and resets an optional, a sequence replaces a vector's items.
+// Nodes and scalar text bound are counted in counter against its limits.
+// Aliases and "<<" merges need the tree to resolve and end binding with Unsupported.
+template <typename T>
+ParseError bindValue(YAMLEventReader& reader, T& out, detail::BindCounter& counter)
+{
+    const yaml_event_t& event = reader.event();
+    if (event.type == YAML_ALIAS_EVENT)
+        return ParseError::Unsupported;
+
+    if constexpr (detail::IsOptional<T>::value) {
+        if (detail::isNull(event)) {
+            out.reset();
+            return ParseError::None;
+        }
+        if (!out)
+            out.emplace();
+        return bindValue(reader, *out, counter);
+    } else {
+        if (detail::isNull(event))
+            return ParseError::None;
+
+        ParseError counted = counter.count(event);
+        if (counted != ParseError::None)
+            return counted;
+
+        if constexpr (Reflect<T>::defined) {
+            if (event.type != YAML_MAPPING_START_EVENT)
+                return ParseError::TypeMismatch;
+
+            while (true) {
+                ParseError error = detail::advance(reader);
+                if (error != ParseError::None || reader.type() == YAML_MAPPING_END_EVENT)
+                    return error;
+
+                // Key text stays valid until the value is read, so it is compared in place
+                bool found = false;
+                if (reader.type() == YAML_SCALAR_EVENT) {
+                    std::string_view key = detail::scalarText(reader.event());
+                    if (key == "<<")
+                        return ParseError::Unsupported;
+                    found = Reflect<T>::visitField(out, keyHash(key), key, [&](auto& field) {
+                        error = counter.count(reader.event());
+                        if (error == ParseError::None)
+                            error = detail::advance(reader);
+                        if (error == ParseError::None)
+                            error = bindValue(reader, field, counter);
+                    });
+                } else {
+                    error = detail::skip(reader);
+                }
+
+                // Keys without a field are skipped along with their values
+                if (error == ParseError::None && !found) {
+                    error = detail::advance(reader);
+                    if (error == ParseError::None)
+                        error = detail::skip(reader);
+                }
+                if (error != ParseError::None)
+                    return error;
+            }
+        } else if constexpr (detail::IsVector<T>::value) {
+            if (event.type != YAML_SEQUENCE_START_EVENT)
+                return ParseError::TypeMismatch;
+
+            out.clear();
+            while (true) {
+                ParseError error = detail::advance(reader);
+                if (error != ParseError::None || reader.type() == YAML_SEQUENCE_END_EVENT)
+                    return error;
+
+                out.emplace_back();
+                error = bindValue(reader, out.back(), counter);
+                if (error != ParseError::None)
+                    return error;
+            }
+        } else {
+            if (event.type != YAML_SCALAR_EVENT)
+                return ParseError::TypeMismatch;
+
+            if constexpr (std::is_same_v<T, std::string>) {
+                out.assign(detail::scalarText(event));
+                return ParseError::None;
+            }
+
+            YAMLResult<T> value = YAMLResult<T>::parse(detail::scalarText(event));
+            if (!value)
+                return ParseError::TypeMismatch;
+            out = value.value();
+            return ParseError::None;
+        }
+    }
+}
+
+// Binds the root of the first document, an empty stream leaves out untouched
+template <typename T>
+ParseError bindDocument(YAMLEventReader& reader, T& out, const ParseLimits& limits = ParseLimits())
+{
+    detail::BindCounter counter{limits};
+    while (reader.next()) {
+        if (reader.type() == YAML_STREAM_START_EVENT || reader.type() == YAML_DOCUMENT_START_EVENT)
+            continue;
+        if (reader.type() == YAML_STREAM_END_EVENT)
+            return ParseError::None;
+        return bindValue(reader, out, counter);
+    }
+    return detail::failure(reader);
+}
+
+} // namespace EmbedYAML
+
+#define EMBEDYAML_EXPAND(x) x
+#define EMBEDYAML_FOR_EACH_1(m, x) m(x)
+#define EMBEDYAML_FOR_EACH_2(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_1(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_3(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_2(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_4(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_3(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_5(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_4(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_6(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_5(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_7(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_6(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_8(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_7(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_9(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_8(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_10(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_9(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_11(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_10(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_12(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_11(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_13(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_12(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_14(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_13(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_15(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_14(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_16(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_15(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_17(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_16(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_18(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_17(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_19(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_18(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_20(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_19(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_21(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_20(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_22(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_21(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_23(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_22(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_24(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_23(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_25(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_24(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_26(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_25(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_27(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_26(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_28(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_27(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_29(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_28(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_30(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_29(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_31(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_30(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_32(m, x, ...) m(x) EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_31(m, __VA_ARGS__))
+#define EMBEDYAML_FOR_EACH_SELECT(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, \
+    _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, name, ...) name
+#define EMBEDYAML_FOR_EACH(m, ...) \
+    EMBEDYAML_EXPAND(EMBEDYAML_FOR_EACH_SELECT(__VA_ARGS__, \
+        EMBEDYAML_FOR_EACH_32, EMBEDYAML_FOR_EACH_31, EMBEDYAML_FOR_EACH_30, EMBEDYAML_FOR_EACH_29, \
+        EMBEDYAML_FOR_EACH_28, EMBEDYAML_FOR_EACH_27, EMBEDYAML_FOR_EACH_26, EMBEDYAML_FOR_EACH_25, \
+        EMBEDYAML_FOR_EACH_24, EMBEDYAML_FOR_EACH_23, EMBEDYAML_FOR_EACH_22, EMBEDYAML_FOR_EACH_21, \
+        EMBEDYAML_FOR_EACH_20, EMBEDYAML_FOR_EACH_19, EMBEDYAML_FOR_EACH_18, EMBEDYAML_FOR_EACH_17, \
+        EMBEDYAML_FOR_EACH_16, EMBEDYAML_FOR_EACH_15, EMBEDYAML_FOR_EACH_14, EMBEDYAML_FOR_EACH_13, \
+        EMBEDYAML_FOR_EACH_12, EMBEDYAML_FOR_EACH_11, EMBEDYAML_FOR_EACH_10, EMBEDYAML_FOR_EACH_9, \
+        EMBEDYAML_FOR_EACH_8, EMBEDYAML_FOR_EACH_7, EMBEDYAML_FOR_EACH_6, EMBEDYAML_FOR_EACH_5, \
+        EMBEDYAML_FOR_EACH_4, EMBEDYAML_FOR_EACH_3, EMBEDYAML_FOR_EACH_2, EMBEDYAML_FOR_EACH_1)(m, __VA_ARGS__))
+
+#define EMBEDYAML_REFLECT_CASE(field)                                                                               \
+    case ::EmbedYAML::keyHash(#field):                                                                              \
+        if (key != #field)                                                                                          \
+            return false;                                                                                           \
+        visitor(object.field);                                                                                      \
+        return true;
+
+// Declares the fields of Struct that bind to keys of the same name, at global scope:
+//   EMBEDYAML_REFLECT(ImuConfig, rate, gain, axes)
+// Keys are dispatched through a switch over their hashes computed at compile time, a
+// hash collision between two fields fails to compile as a duplicate case.
+#define EMBEDYAML_REFLECT(Struct, ...)                                                                              \
+    template <>                                                                                                     \
+    struct EmbedYAML::Reflect<Struct> {                                                                             \
+        static constexpr bool defined = true;                                                                       \
+                                                                                                                    \
+        template <typename Visitor>                                                                                 \
+        static bool visitField(Struct& object, uint32_t hash, std::string_view key, Visitor&& visitor)              \
+        {                                                                                                           \
+            switch (hash)                                                                                           \
+            {                                                                                                       \
+            EMBEDYAML_FOR_EACH(EMBEDYAML_REFLECT_CASE, __VA_ARGS__)                                                 \
+            default:                                                                                                \
+                return false;                                                                                       \
+            }                                                                                                       \
+        }                                                                                                           \
+    };
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+enum class SchemaViolation {
+    None,
+    WrongType,
+    UnknownKey,     // A key outside properties where additional_properties is false
+    MissingKey,     // A required key was still absent when its mapping ended
+    OutOfRange,     // A number below minimum or above maximum
+    NotInEnum,
+    WrongSize       // Scalar bytes, mapping entries or sequence items outside min_size and max_size
+};
+
+// How and where the last parse broke its schema, the path in the syntax Path reads
+struct SchemaReport {
+    SchemaViolation violation = SchemaViolation::None;
+    std::string path;
+};
+
+// Rules a document has to follow, written in YAML and compiled into tables that the parser
+// checks as each event arrives. A violating document is rejected at the first bad node.
+//
+//   type: mapping
+//   required: [name, rate]
+//   additional_properties: false
+//   properties:
+//     name: {type: string, max_size: 32}
+//     rate: {type: integer, minimum: 1, maximum: 1000}
+//     mode: {enum: [fast, slow]}
+//     axes: {type: sequence, max_size: 3, items: {type: number}}
+//
+// type is any, null, bool, integer, number, string, mapping or sequence, or a list of them.
+// Scalars are typed by their text as tryAs() reads it, so string accepts every scalar and
+// number accepts integers. additional_properties is true, false or a rule for other keys.
+class Schema {
+public:
+    Schema() = default;
+
+    // Leaves the schema invalid when the definition is malformed, see errorPath(). An invalid
+    // schema rejects every document.
+    explicit Schema(const YAMLNode& definition);
+
+    bool valid() const { return m_valid; }
+
+    // Where the first malformed rule sits in the definition, empty for the root
+    const std::string& errorPath() const { return m_error_path; }
+
+    // Checks a tree built without the schema and lists every violation in document order, a
+    // node's own before those inside it. Subtrees are checked on a pool of threads, zero picks
+    // the hardware concurrency and one checks on the calling thread. The list is the same for
+    // any number of threads.
+    std::vector<SchemaReport> validate(const YAMLNode& root, unsigned threads = 0) const;
+
+private:
+    friend class SchemaValidator;
+    class Walker;
+
+    // Kinds of node a rule accepts, a bit per type name
+    static constexpr uint8_t NULL_TYPE = 1;
+    static constexpr uint8_t BOOL_TYPE = 2;
+    static constexpr uint8_t INTEGER_TYPE = 4;
+    static constexpr uint8_t NUMBER_TYPE = 8;
+    static constexpr uint8_t STRING_TYPE = 16;
+    static constexpr uint8_t MAPPING_TYPE = 32;
+    static constexpr uint8_t SEQUENCE_TYPE = 64;
+    static constexpr uint8_t SCALAR_TYPES = 31;
+    static constexpr uint8_t ANY_TYPE = 127;
+
+    // Rule 0 accepts anything, NO_RULE stands for additional_properties: false
+    static constexpr uint32_t ANY_RULE = 0;
+    static constexpr uint32_t NO_RULE = UINT32_MAX;
+    static constexpr uint32_t NOT_REQUIRED = UINT32_MAX;
+
+    struct Rule {
+        uint8_t types = ANY_TYPE;
+        uint32_t items = ANY_RULE;
+        uint32_t additional = ANY_RULE;
+        uint32_t first_property = 0;    // The properties of a rule are contiguous, sorted by hash
+        uint32_t property_count = 0;
+        uint32_t required_count = 0;
+        uint32_t first_enum = 0;
+        uint32_t enum_count = 0;
+        double minimum = -HUGE_VAL;
+        double maximum = HUGE_VAL;
+        size_t min_size = 0;
+        size_t max_size = SIZE_MAX;
+    };
+
+    struct Property {
+        uint32_t hash;
+        std::string key;
+        uint32_t rule;
+        uint32_t required;      // Bit of the key in its mapping's seen set, or NOT_REQUIRED
+    };
+
+    uint32_t compile(const YAMLNode& definition, const std::string& path);
+    uint32_t fail(const std::string& path);
+
+    const Property* findProperty(const Rule& rule, std::string_view key, uint32_t hash) const;
+    SchemaViolation checkScalar(const Rule& rule, std::string_view text) const;
+
+    std::vector<Rule> m_rules;
+    std::vector<Property> m_properties;
+    std::vector<std::string> m_enums;
+    uint32_t m_root = ANY_RULE;
+    bool m_valid = false;
+    std::string m_error_path;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace EmbedYAML {
+
+// Allocator over a caller-supplied buffer for builds without a heap. Blocks come in
+// power-of-two size classes with a free list per class, so allocation and release take
+// bounded time and fail by returning null once no block is large enough.
+class StaticPool {
+public:
+    StaticPool(void* buffer, size_t size);
+
+    StaticPool(const StaticPool&) = delete;
+    StaticPool& operator=(const StaticPool&) = delete;
+
+    // Null when the pool is exhausted, blocks are aligned for any type
+    void* allocate(size_t size);
+    void deallocate(void* ptr);
+
+    bool owns(const void* ptr) const { return ptr >= m_begin && ptr < m_end; }
+
+    size_t capacity() const { return (size_t)(m_end - m_begin); }
+    size_t used() const { return m_used; }
+    size_t peak() const { return m_peak; }
+
+    // In builds with EMBEDYAML_STATIC_POOL, every operator new, over-aligned ones included,
+    // and every libyaml allocation is served from the installed pool and fails rather than
+    // falling back to the heap.
+    // The pool has to stay installed for as long as any of its blocks are alive.
+    static void install(StaticPool* pool);
+    static StaticPool* installed();
+
+private:
+    static constexpr size_t CLASSES = sizeof(size_t) * 8;
+
+    struct Lock {
+        explicit Lock(std::atomic_flag& flag);
+        ~Lock();
+        std::atomic_flag& m_flag;
+    };
+
+    unsigned char* m_begin;
+    unsigned char* m_top;
+    unsigned char* m_end;
+    void* m_free[CLASSES] = {};
+    size_t m_used = 0;
+    size_t m_peak = 0;
+    std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+};
+
+} // namespace EmbedYAML
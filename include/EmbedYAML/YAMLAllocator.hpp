@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace EmbedYAML {
+
+// Memory source for everything libyaml allocates: tokens, events, anchors and its buffers.
+// Blocks must be aligned for any type, deallocate() receives the size that was allocated.
+// Calls can come from any thread that parses, including pipeline and pool workers.
+class YAMLAllocator {
+public:
+    virtual ~YAMLAllocator() = default;
+
+    // Null when out of memory, the parse then ends with ParseError::OutOfMemory
+    virtual void* allocate(size_t size) = 0;
+    virtual void deallocate(void* ptr, size_t size) = 0;
+};
+
+// Routes libyaml through the allocator, null restores operator new. Blocks remember the
+// allocator they came from, so it has to outlive every parser and event it served.
+void setYAMLAllocator(YAMLAllocator* allocator);
+YAMLAllocator* getYAMLAllocator();
+
+// libyaml allocation traffic of one parse, sizes exclude the per-block bookkeeping
+struct AllocationStats {
+    size_t allocations = 0;     // Growing a block that cannot stay in place counts as one
+    size_t deallocations = 0;
+    size_t bytes = 0;           // Requested across all allocations
+    size_t live_bytes = 0;      // Still held, zero once the parser is released
+    size_t peak_bytes = 0;
+
+    AllocationStats& operator+=(const AllocationStats& other) {
+        allocations += other.allocations;
+        deallocations += other.deallocations;
+        bytes += other.bytes;
+        live_bytes += other.live_bytes;
+        peak_bytes += other.peak_bytes;
+        return *this;
+    }
+};
+
+} // namespace EmbedYAML
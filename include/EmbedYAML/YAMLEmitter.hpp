@@ -0,0 +1,77 @@
+#pragma once
+
+#include <EmbedYAML/BlockWriter.hpp>
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace EmbedYAML {
+
+enum class EmitError {
+    None,
+    WriteFailed,
+    BadEvent        // A key outside a mapping, a value where a key belongs or an end() without a collection
+};
+
+// Writes block-style YAML from a tree or from events such as
+//   beginMapping(), key("rate"), scalar("100"), end()
+// through a BlockWriter, so memory does not grow with the document. Every document after the
+// first is preceded by "---".
+class YAMLEmitter {
+public:
+    // Allocates a buffer of buffer_size bytes
+    explicit YAMLEmitter(EYWriteBlockFunction write, size_t buffer_size = 4096)
+        : m_out(std::move(write), buffer_size) {}
+
+    // Uses a caller-owned buffer, which must not be empty and must outlive the emitter
+    YAMLEmitter(EYWriteBlockFunction write, char* buffer, size_t buffer_size)
+        : m_out(std::move(write), buffer, buffer_size) {}
+
+    YAMLEmitter(const YAMLEmitter&) = delete;
+    YAMLEmitter& operator=(const YAMLEmitter&) = delete;
+
+    // Each returns false once the emitter failed, see error()
+    bool beginMapping();
+    bool beginSequence();
+    bool end();
+    bool key(std::string_view text);
+    bool scalar(std::string_view text);
+
+    // Writes node as the next value, preceded by its key inside a mapping. Aliases are
+    // written out in full.
+    bool emit(const YAMLNode& node);
+
+    // Hands over the output still buffered as a last, shorter block. Nothing is written on
+    // destruction, so a document is only complete once this succeeds.
+    bool flush();
+
+    EmitError error() const { return m_out.failed() ? EmitError::WriteFailed : m_error; }
+
+private:
+    struct Frame {
+        bool is_mapping;
+        bool after_key;     // The value of a key, so its first child starts a new line
+        bool opened;        // A child was written, empty collections are written as {} or [] by end()
+        bool expect_key;
+        size_t indent;      // Column of the collection's own lines
+    };
+
+    bool beginCollection(bool is_mapping);
+    bool beginValue();
+    void open(Frame& frame);
+
+    void putIndent(size_t column);
+    void putScalar(std::string_view text);
+    bool ok() const { return error() == EmitError::None; }
+    bool fail(EmitError error);
+
+    BlockWriter m_out;
+    std::vector<Frame> m_stack;
+    bool m_inline = false;      // The line ends in "- " and the next node continues it
+    bool m_started = false;     // A document was begun, so the next one needs a "---"
+    EmitError m_error = EmitError::None;
+};
+
+} // namespace EmbedYAML
@@ -1,66 +1,371 @@
 #pragma once
 
+#include <EmbedYAML/Exceptions.hpp>
+#include <EmbedYAML/KeyHash.hpp>
+#include <EmbedYAML/YAMLResult.hpp>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
 class YAMLNode {
 public:
+    // Anchored subtrees are shared between their anchor and every alias, never modified in place
+    using Shared = std::shared_ptr<const YAMLNode>;
+
+    enum class Kind {
+        Scalar,
+        Mapping,
+        Sequence
+    };
+
     YAMLNode() = default;
     ~YAMLNode() = default;
 
-    YAMLNode(const std::string &key)
-        : m_key(key), m_data(std::vector<YAMLNode>()) {}
+    // Declared explicitly since the destructor above suppresses the implicit moves, without
+    // which growing a vector of nodes deep-copies every subtree it holds
+    YAMLNode(const YAMLNode &) = default;
+    YAMLNode(YAMLNode &&) noexcept = default;
+    YAMLNode &operator=(const YAMLNode &) = default;
+    YAMLNode &operator=(YAMLNode &&) noexcept = default;
+
+    // An empty mapping
+    YAMLNode(std::string key)
+        : m_key(std::move(key)), m_key_hash(EmbedYAML::keyHash(m_key)), m_data(std::in_place_index<MAPPING>) {}
 
-    YAMLNode(const std::string &key, const std::string &data)
-        : m_key(key), m_data(data) {}
+    YAMLNode(std::string key, std::string data)
+        : m_key(std::move(key)), m_key_hash(EmbedYAML::keyHash(m_key)), m_data(std::move(data)) {}
 
+    // A sequence holding the given items, whose keys are left empty
     YAMLNode(const std::string &key, const std::vector<YAMLNode> &data)
-        : m_key(key), m_data(data) {}
+        : m_key(key), m_key_hash(EmbedYAML::keyHash(m_key)), m_data(std::in_place_index<SEQUENCE>, Sequence{data}) {}
+
+    // An empty node of the given kind
+    YAMLNode(std::string key, Kind kind)
+        : m_key(std::move(key)), m_key_hash(EmbedYAML::keyHash(m_key)) {
+        if (kind == Kind::Mapping) {
+            m_data.emplace<MAPPING>();
+        } else if (kind == Kind::Sequence) {
+            m_data.emplace<SEQUENCE>();
+        }
+    }
+
+    // Refers to a shared subtree under a key of its own
+    YAMLNode(std::string key, Shared target)
+        : m_key(std::move(key)), m_key_hash(EmbedYAML::keyHash(m_key)), m_data(std::move(target)) {}
+
+    const std::string &getKey() const {
+        return m_key;
+    }
+
+    // keyHash() of the key, computed once as the node is built
+    uint32_t getKeyHash() const {
+        return m_key_hash;
+    }
+
+    Kind getKind() const {
+        switch (resolved().m_data.index()) {
+        case MAPPING:
+            return Kind::Mapping;
+        case SEQUENCE:
+            return Kind::Sequence;
+        default:
+            return Kind::Scalar;
+        }
+    }
 
     bool isScalar() const {
-        return m_data.index() == 0;
+        return resolved().m_data.index() == SCALAR;
+    }
+
+    bool isMapping() const {
+        return resolved().m_data.index() == MAPPING;
     }
 
     bool isSequence() const {
-        return m_data.index() == 1;
+        return resolved().m_data.index() == SEQUENCE;
+    }
+
+    // True when the node refers to an anchored subtree instead of holding its own data
+    bool isShared() const {
+        return m_data.index() == SHARED;
+    }
+
+    // The node that actually holds the data, the node itself unless it is shared
+    const YAMLNode &resolved() const {
+        const YAMLNode *node = this;
+        while (node->isShared())
+            node = std::get<Shared>(node->m_data).get();
+        return *node;
+    }
+
+    // Entries of a mapping or items of a sequence, zero for scalars
+    size_t size() const {
+        return isScalar() ? 0 : items().size();
     }
 
     void addNode(const YAMLNode &node) {
-        std::get<std::vector<YAMLNode>>(m_data).push_back(node);
+        nodes().push_back(node);
+    }
+
+    void addNode(YAMLNode &&node) {
+        nodes().push_back(std::move(node));
+    }
+
+    // Releases the spare capacity left in the children once a collection is complete
+    void shrinkToFit() {
+        if (!isShared() && !isScalar()) {
+            nodes().shrink_to_fit();
+        }
     }
 
     void addScalar(const std::string &key, const std::string &data) {
-        std::get<std::vector<YAMLNode>>(m_data).push_back(YAMLNode(key, data));
+        nodes().push_back(YAMLNode(key, data));
     }
 
     void addSequence(const std::string &key, const std::vector<YAMLNode> &data) {
-        std::get<std::vector<YAMLNode>>(m_data).push_back(YAMLNode(key, data));
+        nodes().push_back(YAMLNode(key, data));
     }
 
-        YAMLNode &operator[](size_t index) {
-        return std::get<std::vector<YAMLNode>>(m_data)[index];
+    YAMLNode &operator[](size_t index) {
+        return nodes()[index];
     }
 
+    const YAMLNode &operator[](size_t index) const {
+        return items()[index];
+    }
+
+    // Keys pulled in through a "<<" merge are found in a copy of their merge source, so the
+    // mapping keeps its entries and writes never reach the anchored node merged in
     YAMLNode &operator[](const std::string &key) {
-        for (auto &node : std::get<std::vector<YAMLNode>>(m_data)) {
-            if (node.m_key == key) {
-                return node;
+        YAMLNode *node = isMapping() ? findMutable(key) : nullptr;
+        if (!node) {
+            keyNotFound();
+        }
+        return *node;
+    }
+
+    const YAMLNode &operator[](const std::string &key) const {
+        Shared owner;
+        const YAMLNode *node = find(key, owner);
+        if (!node) {
+            keyNotFound();
+        }
+        return *node;
+    }
+
+    // The entry under key, merged keys included, null when missing or not a mapping.
+    // Unlike operator[] it never throws and never modifies the mapping.
+    const YAMLNode *find(const std::string &key) const {
+        Shared owner;
+        return find(key, owner);
+    }
+
+    // Like find(), but only compares the text of entries whose stored hash matches.
+    // hash has to be EmbedYAML::keyHash(key), as precomputed by a HashedPath.
+    const YAMLNode *findHashed(uint32_t hash, std::string_view key) const {
+        const YAMLNode &node = resolved();
+        if (node.m_data.index() != MAPPING) {
+            return nullptr;
+        }
+
+        for (const auto &child : std::get<MAPPING>(node.m_data).children) {
+            if (child.m_key_hash == hash && child.m_key == key && key != "<<") {
+                return &child;
             }
         }
-        throw std::runtime_error("Key not found");
+
+        Shared owner;
+        return node.findMerged(key, owner);
+    }
+
+    // The child at index, null when out of range or a scalar
+    const YAMLNode *find(size_t index) const {
+        return index < size() ? &items()[index] : nullptr;
     }
 
     operator std::string() const {
-        return std::get<std::string>(m_data);
+        return std::get<std::string>(resolved().m_data);
     }
 
     std::string asScalar() const {
-        return std::get<std::string>(m_data);
+        return std::get<std::string>(resolved().m_data);
+    }
+
+    // Reads a scalar without throwing, see YAMLResult::parse() for the accepted forms
+    template <typename T>
+    YAMLResult<T> tryAs() const {
+        const std::string *text = std::get_if<std::string>(&resolved().m_data);
+        if (!text) {
+            return YAMLValueError::NotScalar;
+        }
+        return YAMLResult<T>::parse(*text);
+    }
+
+    // The entry under key read as T, or fallback when it is missing or does not convert
+    template <typename T>
+    T valueOr(const std::string &key, T fallback) const {
+        const YAMLNode *node = find(key);
+        return node ? node->tryAs<T>().valueOr(std::move(fallback)) : fallback;
+    }
+
+    std::string valueOr(const std::string &key, const char *fallback) const {
+        return valueOr<std::string>(key, fallback);
     }
 
 private:
+    // Children of a mapping or a sequence, as distinct types so that every alternative of
+    // m_data has a type of its own
+    struct Mapping {
+        std::vector<YAMLNode> children;
+    };
+
+    struct Sequence {
+        std::vector<YAMLNode> children;
+    };
+
+    // Alternatives of m_data, mappings and sequences both keep their children contiguously
+    static constexpr size_t SCALAR = 0;
+    static constexpr size_t MAPPING = 1;
+    static constexpr size_t SHARED = 2;
+    static constexpr size_t SEQUENCE = 3;
+
+    [[noreturn]] static void keyNotFound() {
+        EMBEDYAML_THROW(std::runtime_error("Key not found"));
+    }
+
+    // Children of a mapping or sequence, throws std::bad_variant_access for scalars
+    const std::vector<YAMLNode> &items() const {
+        const YAMLNode &node = resolved();
+        if (node.m_data.index() == MAPPING) {
+            return std::get<MAPPING>(node.m_data).children;
+        }
+        return std::get<SEQUENCE>(node.m_data).children;
+    }
+
+    // Children for modification, a shared node first takes a shallow copy whose
+    // children in turn refer into the shared subtree
+    std::vector<YAMLNode> &nodes() {
+        if (isShared()) {
+            Shared target = std::get<Shared>(m_data);
+            while (target->isShared())
+                target = std::get<Shared>(target->m_data);
+
+            if (target->m_data.index() == SCALAR) {
+                m_data.emplace<SCALAR>(std::get<std::string>(target->m_data));
+            } else {
+                const auto &children = target->items();
+                std::vector<YAMLNode> copy;
+                copy.reserve(children.size());
+                for (const auto &child : children) {
+                    if (child.isShared() || child.m_data.index() == SCALAR) {
+                        copy.push_back(child);
+                    } else {
+                        copy.push_back(YAMLNode(child.m_key, Shared(target, &child)));
+                    }
+                }
+                if (target->m_data.index() == MAPPING) {
+                    m_data.emplace<MAPPING>(Mapping{std::move(copy)});
+                } else {
+                    m_data.emplace<SEQUENCE>(Sequence{std::move(copy)});
+                }
+            }
+        }
+        if (m_data.index() == MAPPING) {
+            return std::get<MAPPING>(m_data).children;
+        }
+        return std::get<SEQUENCE>(m_data).children;
+    }
+
+    // Looks up a key among the entries and then the "<<" merge sources, owner keeps
+    // the storage of the result alive when it lies inside a shared subtree
+    const YAMLNode *find(std::string_view key, Shared &owner) const {
+        const YAMLNode *node = this;
+        while (node->isShared()) {
+            owner = std::get<Shared>(node->m_data);
+            node = owner.get();
+        }
+
+        if (node->m_data.index() != MAPPING) {
+            return nullptr;
+        }
+
+        for (const auto &child : std::get<MAPPING>(node->m_data).children) {
+            if (child.m_key == key && key != "<<") {
+                return &child;
+            }
+        }
+
+        return node->findMerged(key, owner);
+    }
+
+    // As find(), copying the merge source that holds the key in place of the shared one
+    YAMLNode *findMutable(std::string_view key) {
+        for (auto &child : nodes()) {
+            if (child.m_key == key && key != "<<") {
+                return &child;
+            }
+        }
+
+        for (auto &child : nodes()) {
+            if (child.m_key != "<<") {
+                continue;
+            }
+            Shared owner;
+            if (child.find(key, owner)) {
+                return child.findMutable(key);
+            }
+            if (!child.isSequence()) {
+                continue;
+            }
+
+            const auto &sources = child.items();
+            for (size_t i = 0; i < sources.size(); ++i) {
+                if (sources[i].isMapping() && sources[i].find(key, owner)) {
+                    return child.nodes()[i].findMutable(key);
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
+    // A merge value is a mapping or a sequence of mappings, earlier sources win
+    const YAMLNode *findMerged(std::string_view key, Shared &owner) const {
+        for (const auto &child : std::get<MAPPING>(m_data).children) {
+            if (child.m_key != "<<") {
+                continue;
+            }
+
+            Shared source_owner = owner;
+            if (const YAMLNode *found = child.find(key, source_owner)) {
+                owner = source_owner;
+                return found;
+            }
+
+            const YAMLNode &source = child.resolved();
+            if (source.m_data.index() != SEQUENCE) {
+                continue;
+            }
+
+            for (const auto &item : std::get<SEQUENCE>(source.m_data).children) {
+                Shared item_owner = source_owner;
+                if (item.isMapping()) {
+                    if (const YAMLNode *found = item.find(key, item_owner)) {
+                        owner = item_owner;
+                        return found;
+                    }
+                }
+            }
+        }
+
+        return nullptr;
+    }
+
     std::string m_key;
-    std::variant<std::string, std::vector<YAMLNode>> m_data;
+    uint32_t m_key_hash = EmbedYAML::keyHash(std::string_view());
+    std::variant<std::string, Mapping, Shared, Sequence> m_data;
 };
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <charconv>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Why a scalar could not be read as the requested type
+enum class YAMLValueError {
+    None,
+    NotScalar,
+    Invalid,        // Not a valid literal of the type
+    OutOfRange
+};
+
+// A converted value or the reason there is none, returned instead of throwing
+template <typename T>
+class YAMLResult {
+public:
+    YAMLResult(T value)
+        : m_value(std::move(value)) {}
+
+    YAMLResult(YAMLValueError error)
+        : m_error(error) {}
+
+    // Reads scalar text as std::string, bool, an integer or a floating point type.
+    // Booleans, integers and floats follow the YAML 1.2 core schema.
+    static YAMLResult parse(std::string_view text) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            return std::string(text);
+        } else if constexpr (std::is_same_v<T, bool>) {
+            if (text == "true" || text == "True" || text == "TRUE") {
+                return true;
+            }
+            if (text == "false" || text == "False" || text == "FALSE") {
+                return false;
+            }
+            return YAMLValueError::Invalid;
+        } else if constexpr (std::is_integral_v<T>) {
+            return parseInteger(text);
+        } else if constexpr (std::is_floating_point_v<T>) {
+            return parseFloat(text);
+        } else {
+            static_assert(std::is_same_v<T, std::string>, "Scalars convert to std::string, bool, integers and floating point");
+        }
+    }
+
+    bool hasValue() const {
+        return m_value.has_value();
+    }
+
+    explicit operator bool() const {
+        return hasValue();
+    }
+
+    // Only valid when hasValue() is true
+    const T &value() const {
+        return *m_value;
+    }
+
+    T valueOr(T fallback) const {
+        return m_value ? *m_value : std::move(fallback);
+    }
+
+    YAMLValueError error() const {
+        return m_error;
+    }
+
+private:
+    // Decimal with an optional sign, or 0x hexadecimal and 0o octal, which the core schema
+    // only has unsigned
+    static YAMLResult parseInteger(std::string_view text) {
+        const char *first = text.data();
+        const char *last = first + text.size();
+        if (first != last && *first == '+') {
+            first++;
+            if (first != last && *first == '-') {
+                return YAMLValueError::Invalid;
+            }
+        }
+
+        int base = 10;
+        if (last - first > 2 && first[0] == '0' && (first[1] == 'x' || first[1] == 'o')) {
+            if (first != text.data()) {
+                return YAMLValueError::Invalid;
+            }
+            base = first[1] == 'x' ? 16 : 8;
+            first += 2;
+            if (*first == '-') {
+                return YAMLValueError::Invalid;
+            }
+        }
+
+        T value{};
+        auto result = std::from_chars(first, last, value, base);
+        if (result.ec == std::errc::result_out_of_range) {
+            return YAMLValueError::OutOfRange;
+        }
+        if (result.ec != std::errc() || result.ptr != last || first == last) {
+            return YAMLValueError::Invalid;
+        }
+        return value;
+    }
+
+    static YAMLResult parseFloat(std::string_view text) {
+        const char *first = text.data();
+        const char *last = first + text.size();
+        bool negative = first != last && *first == '-';
+        if (first != last && (*first == '+' || *first == '-')) {
+            first++;
+        }
+
+        std::string_view rest(first, last - first);
+        if (rest == ".inf" || rest == ".Inf" || rest == ".INF") {
+            return negative ? -std::numeric_limits<T>::infinity() : std::numeric_limits<T>::infinity();
+        }
+        if (rest == ".nan" || rest == ".NaN" || rest == ".NAN") {
+            return first == text.data() ? YAMLResult(std::numeric_limits<T>::quiet_NaN()) : YAMLValueError::Invalid;
+        }
+
+        // from_chars also takes "inf" and "nan", which YAML spells with a leading dot
+        if (first == last || (*first != '.' && (*first < '0' || *first > '9'))) {
+            return YAMLValueError::Invalid;
+        }
+
+        T value{};
+        auto result = std::from_chars(first, last, value);
+        if (result.ec == std::errc::result_out_of_range) {
+            return YAMLValueError::OutOfRange;
+        }
+        if (result.ec != std::errc() || result.ptr != last) {
+            return YAMLValueError::Invalid;
+        }
+        return negative ? -value : value;
+    }
+
+    std::optional<T> m_value;
+    YAMLValueError m_error = YAMLValueError::None;
+};
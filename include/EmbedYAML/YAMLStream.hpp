@@ -0,0 +1,211 @@
+#pragma once
+
+#include <EmbedYAML/Exceptions.hpp>
+#include <EmbedYAML/ParseLimits.hpp>
+#include <EmbedYAML/YAMLAllocator.hpp>
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cstddef>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <yaml.h>
+
+namespace EmbedYAML {
+
+class EmbedYAML;
+class ThreadPool;
+
+// Anchored node shared by its aliases
+struct Anchor {
+    YAMLNode::Shared node;
+    size_t expanded;    // Nodes in the subtree with its own aliases expanded
+};
+
+using AnchorTable = std::unordered_map<std::string, Anchor>;
+
+// Pulls libyaml events from a file opened through the EmbedYAML callbacks. When given
+// stats, every libyaml allocation made for the reader is counted there.
+class YAMLEventReader {
+public:
+    YAMLEventReader(EmbedYAML* ey, std::string filename, AllocationStats* stats = nullptr);
+    // Reads from a caller-owned buffer that must outlive the reader
+    YAMLEventReader(const char* data, size_t length, AllocationStats* stats = nullptr);
+    ~YAMLEventReader();
+
+    YAMLEventReader(const YAMLEventReader&) = delete;
+    YAMLEventReader& operator=(const YAMLEventReader&) = delete;
+
+    bool isOpen() const { return m_open; }
+    bool failed() const { return m_failed; }
+
+    // InputTooLarge when reading stopped at the max_input_bytes limit, OutOfMemory when
+    // libyaml could not allocate, Syntax on other errors
+    ParseError error() const {
+        if (m_input_exceeded)
+            return ParseError::InputTooLarge;
+        if (m_out_of_memory || (m_failed && m_parser.error == YAML_MEMORY_ERROR))
+            return ParseError::OutOfMemory;
+        return m_failed ? ParseError::Syntax : ParseError::None;
+    }
+
+    // Replaces the current event with the next one, false at stream end or on error
+    bool next();
+
+    const yaml_event_t& event() const { return m_event; }
+    yaml_event_type_t type() const { return m_event.type; }
+
+    // Skips the node starting at the current event, leaving its last event current
+    bool skipNode();
+
+private:
+    friend class EmbedYAML;
+
+    EmbedYAML* m_ey;
+    std::string m_filename;
+    AllocationStats* m_stats;
+    yaml_parser_t m_parser;
+    yaml_event_t m_event;
+    size_t m_bytes_read = 0;
+    size_t m_max_input_bytes = 0;
+    bool m_open = false;
+    bool m_has_event = false;
+    bool m_failed = false;
+    bool m_input_exceeded = false;
+    bool m_out_of_memory = false;
+};
+
+// Input range that builds one node at a time, releasing the previous one first
+class YAMLNodeStream {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = YAMLNode;
+        using difference_type = std::ptrdiff_t;
+        using pointer = YAMLNode*;
+        using reference = YAMLNode&;
+
+        iterator() = default;
+        explicit iterator(YAMLNodeStream* stream) : m_stream(stream) {}
+
+        YAMLNode& operator*() const { return m_stream->m_current; }
+        YAMLNode* operator->() const { return &m_stream->m_current; }
+
+        iterator& operator++() {
+            m_stream->advance();
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return done() == other.done(); }
+        bool operator!=(const iterator& other) const { return done() != other.done(); }
+
+    private:
+        bool done() const { return !m_stream || !m_stream->m_has_current; }
+
+        YAMLNodeStream* m_stream = nullptr;
+    };
+
+    virtual ~YAMLNodeStream() = default;
+
+    // Why the stream ended early, None when it ran to completion
+    ParseError error() const { return m_error; }
+
+    iterator begin() {
+        if (!m_started) {
+            m_started = true;
+            advance();
+        }
+        return iterator(this);
+    }
+
+    iterator end() { return iterator(); }
+
+protected:
+    // Builds the next node into out, false once the stream is exhausted
+    virtual bool fetch(YAMLNode& out) = 0;
+
+    ParseError m_error = ParseError::None;
+
+private:
+    // Running out of memory ends the stream like a limit
+    void advance() {
+        m_current = YAMLNode();
+        EMBEDYAML_TRY {
+            m_has_current = fetch(m_current);
+        } EMBEDYAML_CATCH(const std::bad_alloc&) {
+            m_current = YAMLNode();
+            m_has_current = false;
+            m_error = ParseError::OutOfMemory;
+        }
+    }
+
+    YAMLNode m_current;
+    bool m_has_current = false;
+    bool m_started = false;
+};
+
+// Items of a top-level sequence, either the document root or the value of a root key
+class YAMLSequenceStream : public YAMLNodeStream {
+public:
+    YAMLSequenceStream(EmbedYAML* ey, std::string filename, std::string key);
+
+protected:
+    bool fetch(YAMLNode& out) override;
+
+private:
+    bool seek();
+    bool skipValue();
+
+    YAMLEventReader m_reader;
+    std::string m_key;
+    ParseLimits m_limits;
+    AnchorTable m_anchors;      // Anchors stay visible to every later item
+    bool m_positioned = false;
+    bool m_finished = false;
+};
+
+// Root nodes of each document in a multi-document stream
+class YAMLDocumentStream : public YAMLNodeStream {
+public:
+    YAMLDocumentStream(EmbedYAML* ey, std::string filename);
+
+protected:
+    bool fetch(YAMLNode& out) override;
+
+private:
+    YAMLEventReader m_reader;
+    ParseLimits m_limits;
+    bool m_finished = false;
+};
+
+// Documents of an in-memory stream parsed concurrently and yielded in stream order
+class YAMLParallelDocumentStream : public YAMLNodeStream {
+public:
+    // A read error, when given, ends the stream before its first document
+    YAMLParallelDocumentStream(std::string input, unsigned threads, const ParseLimits& limits = ParseLimits(),
+                               ParseError read_error = ParseError::None);
+    ~YAMLParallelDocumentStream() override;
+
+protected:
+    bool fetch(YAMLNode& out) override;
+
+private:
+    void schedule();
+
+    std::string m_input;
+    std::vector<std::pair<size_t, size_t>> m_documents;
+    size_t m_next_document = 0;
+    size_t m_window;
+    ParseLimits m_limits;
+    std::deque<std::future<std::pair<std::optional<YAMLNode>, ParseError>>> m_pending;
+    std::unique_ptr<ThreadPool> m_pool;
+};
+
+} // namespace EmbedYAML
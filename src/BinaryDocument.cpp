@@ -0,0 +1,339 @@
+#include "EmbedYAML/BinaryDocument.hpp"
+#include <array>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace EmbedYAML {
+
+namespace {
+
+constexpr char MAGIC_BYTES[4] = {'E', 'Y', 'B', 'D'};
+
+constexpr uint32_t KIND_SHIFT = 30;
+constexpr uint32_t KEY_LENGTH_MASK = (uint32_t(1) << KIND_SHIFT) - 1;
+
+// Nested "<<" merges followed by a lookup, which also bounds crafted merge cycles
+constexpr unsigned MAX_MERGE_DEPTH = 32;
+
+constexpr std::array<uint32_t, 256> makeCrcTable()
+{
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 256> CRC_TABLE = makeCrcTable();
+
+// CRC-32 as used by zlib, continuing from the CRC of the preceding bytes
+uint32_t crc32(uint32_t crc, const unsigned char* data, size_t length)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i)
+        crc = CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// Covers the whole document apart from the checksum field itself
+uint32_t checksum(const unsigned char* document, size_t total)
+{
+    const size_t field = BinaryDocument::CHECKSUM;
+    uint32_t crc = crc32(0, document, field);
+    return crc32(crc, document + field + 4, total - field - 4);
+}
+
+void store32(unsigned char* p, uint32_t value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+uint32_t kindCode(YAMLNode::Kind kind)
+{
+    switch (kind)
+    {
+    case YAMLNode::Kind::Mapping:
+        return 1;
+    case YAMLNode::Kind::Sequence:
+        return 2;
+    default:
+        return 0;
+    }
+}
+
+// Lays the tree out breadth first, so the children of every collection end up contiguous
+class Writer {
+public:
+    BinaryError write(const YAMLNode& root, std::vector<unsigned char>& out)
+    {
+        m_records.emplace_back();
+        m_queue.push_back(&root);
+
+        for (size_t i = 0; i < m_queue.size(); ++i) {
+            if (!place(*m_queue[i], i))
+                return BinaryError::TooLarge;
+        }
+
+        size_t nodes_bytes = m_records.size() * BinaryDocument::RECORD_SIZE;
+        size_t total = BinaryDocument::HEADER_SIZE + nodes_bytes + m_strings.size();
+        if (total > UINT32_MAX)
+            return BinaryError::TooLarge;
+
+        out.assign(total, 0);
+        unsigned char* header = out.data();
+        std::memcpy(header + BinaryDocument::MAGIC, MAGIC_BYTES, sizeof(MAGIC_BYTES));
+        header[BinaryDocument::VERSION_FIELD] = (unsigned char)BinaryDocument::VERSION;
+        header[BinaryDocument::VERSION_FIELD + 1] = (unsigned char)(BinaryDocument::VERSION >> 8);
+        store32(header + BinaryDocument::TOTAL_SIZE, (uint32_t)total);
+        store32(header + BinaryDocument::NODE_COUNT, (uint32_t)m_records.size());
+        store32(header + BinaryDocument::NODE_OFFSET, (uint32_t)BinaryDocument::HEADER_SIZE);
+        store32(header + BinaryDocument::STRING_OFFSET, (uint32_t)(BinaryDocument::HEADER_SIZE + nodes_bytes));
+        store32(header + BinaryDocument::STRING_BYTES, (uint32_t)m_strings.size());
+
+        unsigned char* p = header + BinaryDocument::HEADER_SIZE;
+        for (const auto& record : m_records) {
+            for (uint32_t field : record) {
+                store32(p, field);
+                p += 4;
+            }
+        }
+        std::memcpy(p, m_strings.data(), m_strings.size());
+
+        store32(header + BinaryDocument::CHECKSUM, checksum(header, total));
+        return BinaryError::None;
+    }
+
+private:
+    using Fields = std::array<uint32_t, 4>;
+
+    bool place(const YAMLNode& node, size_t index)
+    {
+        const YAMLNode& target = node.resolved();
+        const std::string& key = node.getKey();
+        uint32_t kind = kindCode(target.getKind());
+
+        if (key.size() > KEY_LENGTH_MASK)
+            return false;
+
+        Fields fields{intern(key), kind << KIND_SHIFT | (uint32_t)key.size(), 0, 0};
+
+        if (target.isScalar()) {
+            std::string value = target.asScalar();
+            if (value.size() > UINT32_MAX)
+                return false;
+            fields[2] = intern(value);
+            fields[3] = (uint32_t)value.size();
+        } else if (node.isShared() && m_shared.count(&target)) {
+            // Later aliases of an anchor reuse its children
+            fields[2] = m_shared[&target].first;
+            fields[3] = m_shared[&target].second;
+        } else {
+            if (m_records.size() + target.size() > UINT32_MAX)
+                return false;
+            fields[2] = (uint32_t)m_records.size();
+            fields[3] = (uint32_t)target.size();
+            for (size_t i = 0; i < target.size(); ++i) {
+                m_records.emplace_back();
+                m_queue.push_back(&target[i]);
+            }
+            if (node.isShared())
+                m_shared[&target] = {fields[2], fields[3]};
+        }
+
+        m_records[index] = fields;
+        return m_strings.size() <= UINT32_MAX;
+    }
+
+    uint32_t intern(const std::string& text)
+    {
+        auto it = m_offsets.find(text);
+        if (it != m_offsets.end())
+            return it->second;
+
+        uint32_t offset = (uint32_t)m_strings.size();
+        m_strings.append(text);
+        m_strings.push_back('\0');
+        m_offsets.emplace(text, offset);
+        return offset;
+    }
+
+    std::vector<Fields> m_records;
+    std::vector<const YAMLNode*> m_queue;
+    std::string m_strings;
+    std::unordered_map<std::string, uint32_t> m_offsets;
+    std::unordered_map<const YAMLNode*, std::pair<uint32_t, uint32_t>> m_shared;
+};
+
+} // namespace
+
+BinaryError BinaryDocument::load(const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    m_data = nullptr;
+
+    if (size < HEADER_SIZE)
+        return BinaryError::Truncated;
+    if (std::memcmp(bytes + MAGIC, MAGIC_BYTES, sizeof(MAGIC_BYTES)) != 0)
+        return BinaryError::BadMagic;
+    if ((uint16_t)(bytes[VERSION_FIELD] | bytes[VERSION_FIELD + 1] << 8) != VERSION)
+        return BinaryError::UnsupportedVersion;
+
+    uint64_t total = read32(bytes + TOTAL_SIZE);
+    uint64_t node_count = read32(bytes + NODE_COUNT);
+    uint64_t node_offset = read32(bytes + NODE_OFFSET);
+    uint64_t string_offset = read32(bytes + STRING_OFFSET);
+    uint64_t string_bytes = read32(bytes + STRING_BYTES);
+
+    if (total > size)
+        return BinaryError::Truncated;
+    if (total < HEADER_SIZE || node_count == 0 || node_offset < HEADER_SIZE
+        || node_offset + node_count * RECORD_SIZE > total || string_offset < HEADER_SIZE
+        || string_offset + string_bytes > total)
+        return BinaryError::Corrupt;
+    if (checksum(bytes, total) != read32(bytes + CHECKSUM))
+        return BinaryError::ChecksumMismatch;
+
+    m_nodes = bytes + node_offset;
+    m_strings = bytes + string_offset;
+    m_node_count = (uint32_t)node_count;
+
+    // Every string has to end inside the pool with its NUL, every child range inside the table
+    for (uint32_t i = 0; i < m_node_count; ++i) {
+        Record r = record(i);
+        uint64_t key_length = r.info & KEY_LENGTH_MASK;
+        uint32_t kind = r.info >> KIND_SHIFT;
+
+        if (kind > 2 || r.key + key_length >= string_bytes || m_strings[r.key + key_length] != '\0')
+            return BinaryError::Corrupt;
+
+        if (kind == 0) {
+            if ((uint64_t)r.data + r.size >= string_bytes || m_strings[r.data + r.size] != '\0')
+                return BinaryError::Corrupt;
+        } else if ((uint64_t)r.data + r.size > node_count) {
+            return BinaryError::Corrupt;
+        }
+    }
+
+    m_data = bytes;
+    return BinaryError::None;
+}
+
+NodeRef BinaryDocument::root() const
+{
+    return m_data ? NodeRef(this, 0) : NodeRef();
+}
+
+BinaryError BinaryDocument::write(const YAMLNode& root, std::vector<unsigned char>& out)
+{
+    return Writer().write(root, out);
+}
+
+BinaryDocument::Record BinaryDocument::record(uint32_t index) const
+{
+    const unsigned char* p = m_nodes + (size_t)index * RECORD_SIZE;
+    return Record{read32(p), read32(p + 4), read32(p + 8), read32(p + 12)};
+}
+
+std::string_view BinaryDocument::string(uint32_t offset, uint32_t length) const
+{
+    return std::string_view((const char*)m_strings + offset, length);
+}
+
+YAMLNode::Kind NodeRef::getKind() const
+{
+    switch (m_document->record(m_index).info >> KIND_SHIFT)
+    {
+    case 1:
+        return YAMLNode::Kind::Mapping;
+    case 2:
+        return YAMLNode::Kind::Sequence;
+    default:
+        return YAMLNode::Kind::Scalar;
+    }
+}
+
+std::string_view NodeRef::getKey() const
+{
+    if (!valid())
+        return std::string_view();
+
+    BinaryDocument::Record r = m_document->record(m_index);
+    return m_document->string(r.key, r.info & KEY_LENGTH_MASK);
+}
+
+std::string_view NodeRef::asScalar() const
+{
+    if (!isScalar())
+        return std::string_view();
+
+    BinaryDocument::Record r = m_document->record(m_index);
+    return m_document->string(r.data, r.size);
+}
+
+size_t NodeRef::size() const
+{
+    if (!valid() || isScalar())
+        return 0;
+    return m_document->record(m_index).size;
+}
+
+NodeRef NodeRef::operator[](size_t index) const
+{
+    if (index >= size())
+        return NodeRef();
+    return NodeRef(m_document, m_document->record(m_index).data + (uint32_t)index);
+}
+
+NodeRef NodeRef::find(std::string_view key) const
+{
+    unsigned budget = valid() ? m_document->m_node_count : 0;
+    return findEntry(key, 0, budget);
+}
+
+// A merge value is a mapping or a sequence of mappings, earlier sources win. Depth and
+// budget bound the sources searched, which only matters for crafted merge cycles.
+NodeRef NodeRef::findEntry(std::string_view key, unsigned depth, unsigned& budget) const
+{
+    if (!isMapping() || depth > MAX_MERGE_DEPTH || budget == 0)
+        return NodeRef();
+    budget--;
+
+    BinaryDocument::Record r = m_document->record(m_index);
+    uint32_t end = r.data + r.size;
+
+    if (key != "<<") {
+        for (uint32_t i = r.data; i < end; ++i) {
+            BinaryDocument::Record entry = m_document->record(i);
+            if (m_document->string(entry.key, entry.info & KEY_LENGTH_MASK) == key)
+                return NodeRef(m_document, i);
+        }
+    }
+
+    for (uint32_t i = r.data; i < end; ++i) {
+        NodeRef entry(m_document, i);
+        if (entry.getKey() != "<<")
+            continue;
+
+        if (NodeRef found = entry.findEntry(key, depth + 1, budget))
+            return found;
+
+        if (!entry.isSequence())
+            continue;
+
+        for (size_t j = 0; j < entry.size(); ++j) {
+            if (NodeRef found = entry[j].findEntry(key, depth + 1, budget))
+                return found;
+        }
+    }
+
+    return NodeRef();
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,50 @@
+#include "EmbedYAML/BlockWriter.hpp"
+#include <algorithm>
+
+namespace EmbedYAML {
+
+BlockWriter::BlockWriter(EYWriteBlockFunction write, size_t buffer_size)
+    : m_write(std::move(write)),
+      m_owned(std::max<size_t>(buffer_size, 1)),
+      m_buffer(m_owned.data()),
+      m_capacity(m_owned.size())
+{
+}
+
+BlockWriter::BlockWriter(EYWriteBlockFunction write, char* buffer, size_t buffer_size)
+    : m_write(std::move(write)),
+      m_buffer(buffer),
+      m_capacity(buffer_size),
+      m_failed(!buffer || buffer_size == 0)
+{
+}
+
+bool BlockWriter::flush()
+{
+    if (!m_failed && m_used > 0)
+        writeBlock();
+    return !m_failed;
+}
+
+// Fills the buffer up and writes it out for as long as text lasts
+void BlockWriter::putBlocks(std::string_view text)
+{
+    while (!text.empty() && !m_failed) {
+        size_t length = std::min(text.size(), m_capacity - m_used);
+        std::memcpy(m_buffer + m_used, text.data(), length);
+        m_used += length;
+        text.remove_prefix(length);
+
+        if (m_used == m_capacity)
+            writeBlock();
+    }
+}
+
+void BlockWriter::writeBlock()
+{
+    if (m_write(m_buffer, m_used) < 0)
+        m_failed = true;
+    m_used = 0;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,397 @@
+#include "CompactDecoder.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace EmbedYAML {
+
+namespace {
+
+bool exceeds(size_t value, size_t limit)
+{
+    return limit && value > limit;
+}
+
+std::string base64(const std::string& bytes)
+{
+    static const char DIGITS[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    out.reserve((bytes.size() + 2) / 3 * 4);
+    for (size_t i = 0; i < bytes.size(); i += 3) {
+        uint32_t group = (uint32_t)(unsigned char)bytes[i] << 16;
+        if (i + 1 < bytes.size())
+            group |= (uint32_t)(unsigned char)bytes[i + 1] << 8;
+        if (i + 2 < bytes.size())
+            group |= (uint32_t)(unsigned char)bytes[i + 2];
+
+        out += DIGITS[group >> 18];
+        out += DIGITS[(group >> 12) & 0x3F];
+        out += i + 1 < bytes.size() ? DIGITS[(group >> 6) & 0x3F] : '=';
+        out += i + 2 < bytes.size() ? DIGITS[group & 0x3F] : '=';
+    }
+    return out;
+}
+
+// Whole numbers keep a fraction so they still read as floats
+std::string floatText(double value)
+{
+    if (std::isnan(value))
+        return ".nan";
+    if (std::isinf(value))
+        return value < 0 ? "-.inf" : ".inf";
+
+    char number[32];
+    auto result = std::to_chars(number, number + sizeof(number), value);
+    std::string text(number, result.ptr);
+    if (text.find_first_of(".e") == std::string::npos)
+        text += ".0";
+    return text;
+}
+
+double halfToDouble(uint16_t half)
+{
+    int exponent = (half >> 10) & 0x1F;
+    int mantissa = half & 0x3FF;
+
+    double value;
+    if (exponent == 0)
+        value = std::ldexp(mantissa, -24);
+    else if (exponent != 31)
+        value = std::ldexp(mantissa + 1024, exponent - 25);
+    else
+        value = mantissa == 0 ? HUGE_VAL : std::nan("");
+    return half & 0x8000 ? -value : value;
+}
+
+double singleToDouble(uint32_t bits)
+{
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double doubleFromBits(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+ParseError CompactDecoder::decode(YAMLNode& out)
+{
+    std::vector<Frame> stack;
+    size_t nodes = 0;
+
+    // Children of a mapping take the key read before them
+    auto childKey = [&stack]() {
+        if (stack.empty())
+            return std::string("root");
+        return stack.back().is_mapping ? std::move(stack.back().key) : std::string();
+    };
+
+    while (true) {
+        Item item;
+        ParseError error = m_format == CompactFormat::CBOR ? readCbor(item) : readMessagePack(item);
+        if (error != ParseError::None)
+            return error;
+
+        if (item.kind == Item::Kind::Break) {
+            if (stack.empty() || !stack.back().indefinite || (stack.back().is_mapping && !stack.back().expect_key))
+                return ParseError::Syntax;
+
+            YAMLNode node = std::move(stack.back().node);
+            node.shrinkToFit();
+            stack.pop_back();
+            if (complete(stack, std::move(node), out))
+                return ParseError::None;
+            continue;
+        }
+
+        if (exceeds(++nodes, m_limits.max_nodes))
+            return ParseError::TooManyNodes;
+
+        bool is_key = !stack.empty() && stack.back().is_mapping && stack.back().expect_key;
+        if (item.kind == Item::Kind::Scalar) {
+            m_scalar_bytes += item.text.size();
+            if (exceeds(m_scalar_bytes, m_limits.max_scalar_bytes))
+                return ParseError::ScalarBytesExceeded;
+
+            if (is_key) {
+                stack.back().key = std::move(item.text);
+                stack.back().expect_key = false;
+                continue;
+            }
+            if (complete(stack, YAMLNode(childKey(), std::move(item.text)), out))
+                return ParseError::None;
+            continue;
+        }
+
+        // A tree has no key made of a collection
+        if (is_key)
+            return ParseError::Unsupported;
+        if (exceeds(stack.size() + 1, m_limits.max_depth))
+            return ParseError::TooDeep;
+
+        bool is_mapping = item.kind == Item::Kind::Mapping;
+        YAMLNode node(childKey(), is_mapping ? YAMLNode::Kind::Mapping : YAMLNode::Kind::Sequence);
+        if (!item.indefinite && item.size == 0) {
+            if (complete(stack, std::move(node), out))
+                return ParseError::None;
+            continue;
+        }
+        stack.push_back(Frame{std::move(node), std::string(), item.size, item.indefinite, is_mapping, is_mapping});
+    }
+}
+
+// The initial byte holds the major type and either the argument or how many bytes follow
+// with it. Tags only annotate the item after them and are skipped.
+ParseError CompactDecoder::readCbor(Item& item)
+{
+    while (true) {
+        if (m_position == m_size)
+            return ParseError::Syntax;
+
+        unsigned char initial = m_data[m_position++];
+        unsigned major = initial >> 5;
+        unsigned info = initial & 0x1F;
+
+        bool indefinite = info == 31;
+        uint64_t argument = info;
+        if (info >= 28 && info <= 30)
+            return ParseError::Syntax;
+        if (info >= 24 && !indefinite && !readBigEndian(size_t(1) << (info - 24), argument))
+            return ParseError::Syntax;
+
+        switch (major)
+        {
+        case 0:
+            if (indefinite)
+                return ParseError::Syntax;
+            item.text = std::to_string(argument);
+            return ParseError::None;
+        case 1:
+            // The value is -1 - argument, which may lie below the range of int64_t
+            if (indefinite)
+                return ParseError::Syntax;
+            if (argument <= (uint64_t)INT64_MAX)
+                item.text = std::to_string(-1 - (int64_t)argument);
+            else if (argument < UINT64_MAX)
+                item.text = "-" + std::to_string(argument + 1);
+            else
+                item.text = "-18446744073709551616";
+            return ParseError::None;
+        case 2:
+        case 3: {
+            ParseError error = readCborText(major, argument, indefinite, item.text);
+            if (error == ParseError::None && major == 2)
+                item.text = base64(item.text);
+            return error;
+        }
+        case 4:
+        case 5:
+            item.kind = major == 5 ? Item::Kind::Mapping : Item::Kind::Sequence;
+            item.size = argument;
+            item.indefinite = indefinite;
+            return ParseError::None;
+        case 6:
+            if (indefinite)
+                return ParseError::Syntax;
+            continue;
+        default:
+            break;
+        }
+
+        switch (info)
+        {
+        case 20:
+        case 21:
+            item.text = info == 21 ? "true" : "false";
+            return ParseError::None;
+        case 22:
+        case 23:
+            item.text = "null";
+            return ParseError::None;
+        case 25:
+            item.text = floatText(halfToDouble((uint16_t)argument));
+            return ParseError::None;
+        case 26:
+            item.text = floatText(singleToDouble((uint32_t)argument));
+            return ParseError::None;
+        case 27:
+            item.text = floatText(doubleFromBits(argument));
+            return ParseError::None;
+        case 31:
+            item.kind = Item::Kind::Break;
+            return ParseError::None;
+        default:
+            // Simple values other than false, true, null and undefined
+            return ParseError::Unsupported;
+        }
+    }
+}
+
+// Strings of indefinite length are a run of definite chunks of the same type ended by a break
+ParseError CompactDecoder::readCborText(unsigned major, uint64_t length, bool indefinite, std::string& out)
+{
+    if (!indefinite)
+        return readBytes(length, out) ? ParseError::None : ParseError::Syntax;
+
+    std::string chunk;
+    while (true) {
+        if (m_position == m_size)
+            return ParseError::Syntax;
+
+        unsigned char initial = m_data[m_position++];
+        if (initial == 0xFF)
+            return ParseError::None;
+
+        unsigned info = initial & 0x1F;
+        uint64_t chunk_length = info;
+        if ((unsigned)(initial >> 5) != major || info >= 28)
+            return ParseError::Syntax;
+        if (info >= 24 && !readBigEndian(size_t(1) << (info - 24), chunk_length))
+            return ParseError::Syntax;
+        if (!readBytes(chunk_length, chunk))
+            return ParseError::Syntax;
+        out += chunk;
+    }
+}
+
+// Fixed-size formats carry their value or size in the lead byte, the others in the
+// 1 to 8 bytes after it
+ParseError CompactDecoder::readMessagePack(Item& item)
+{
+    if (m_position == m_size)
+        return ParseError::Syntax;
+
+    unsigned char lead = m_data[m_position++];
+    uint64_t value = 0;
+
+    if (lead <= 0x7F) {
+        item.text = std::to_string(lead);
+        return ParseError::None;
+    }
+    if (lead >= 0xE0) {
+        item.text = std::to_string((int)(int8_t)lead);
+        return ParseError::None;
+    }
+    if (lead <= 0x9F) {
+        item.kind = lead <= 0x8F ? Item::Kind::Mapping : Item::Kind::Sequence;
+        item.size = lead & 0x0F;
+        return ParseError::None;
+    }
+    if (lead <= 0xBF)
+        return readBytes(lead & 0x1F, item.text) ? ParseError::None : ParseError::Syntax;
+
+    switch (lead)
+    {
+    case 0xC0:
+        item.text = "null";
+        return ParseError::None;
+    case 0xC2:
+    case 0xC3:
+        item.text = lead == 0xC3 ? "true" : "false";
+        return ParseError::None;
+    case 0xC4:
+    case 0xC5:
+    case 0xC6:
+        if (!readBigEndian(size_t(1) << (lead - 0xC4), value) || !readBytes(value, item.text))
+            return ParseError::Syntax;
+        item.text = base64(item.text);
+        return ParseError::None;
+    case 0xCA:
+        if (!readBigEndian(4, value))
+            return ParseError::Syntax;
+        item.text = floatText(singleToDouble((uint32_t)value));
+        return ParseError::None;
+    case 0xCB:
+        if (!readBigEndian(8, value))
+            return ParseError::Syntax;
+        item.text = floatText(doubleFromBits(value));
+        return ParseError::None;
+    case 0xCC:
+    case 0xCD:
+    case 0xCE:
+    case 0xCF:
+        if (!readBigEndian(size_t(1) << (lead - 0xCC), value))
+            return ParseError::Syntax;
+        item.text = std::to_string(value);
+        return ParseError::None;
+    case 0xD0:
+    case 0xD1:
+    case 0xD2:
+    case 0xD3: {
+        // Sign-extended from the top bit of the bytes read
+        unsigned bits = 8u << (lead - 0xD0);
+        if (!readBigEndian(bits / 8, value))
+            return ParseError::Syntax;
+        int64_t integer = bits == 64 ? (int64_t)value : (int64_t)(value << (64 - bits)) >> (64 - bits);
+        item.text = std::to_string(integer);
+        return ParseError::None;
+    }
+    case 0xD9:
+    case 0xDA:
+    case 0xDB:
+        if (!readBigEndian(size_t(1) << (lead - 0xD9), value) || !readBytes(value, item.text))
+            return ParseError::Syntax;
+        return ParseError::None;
+    case 0xDC:
+    case 0xDD:
+    case 0xDE:
+    case 0xDF:
+        if (!readBigEndian(lead & 1 ? 4 : 2, value))
+            return ParseError::Syntax;
+        item.kind = lead >= 0xDE ? Item::Kind::Mapping : Item::Kind::Sequence;
+        item.size = value;
+        return ParseError::None;
+    case 0xC1:
+        return ParseError::Syntax;
+    default:
+        // Extension types, whose meaning is up to the application
+        return ParseError::Unsupported;
+    }
+}
+
+bool CompactDecoder::readBigEndian(size_t bytes, uint64_t& value)
+{
+    if (m_size - m_position < bytes)
+        return false;
+
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i)
+        value = value << 8 | m_data[m_position++];
+    return true;
+}
+
+bool CompactDecoder::readBytes(uint64_t length, std::string& out)
+{
+    if (m_size - m_position < length)
+        return false;
+
+    out.assign((const char*)m_data + m_position, (size_t)length);
+    m_position += (size_t)length;
+    return true;
+}
+
+bool CompactDecoder::complete(std::vector<Frame>& stack, YAMLNode&& node, YAMLNode& out)
+{
+    while (!stack.empty()) {
+        Frame& top = stack.back();
+        top.node.addNode(std::move(node));
+        top.expect_key = top.is_mapping;
+        if (top.indefinite || --top.remaining > 0)
+            return false;
+
+        node = std::move(top.node);
+        node.shrinkToFit();
+        stack.pop_back();
+    }
+
+    out = std::move(node);
+    return true;
+}
+
+} // namespace EmbedYAML
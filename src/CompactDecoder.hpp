@@ -0,0 +1,67 @@
+#pragma once
+
+#include "EmbedYAML/EmbedYAML.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Reads one CBOR data item or MessagePack object back into a tree. Scalars become the text
+// the YAML core schema reads as the same value, byte strings become base64 text and CBOR
+// tags are dropped. Sizes in the input are never used to reserve memory, so a short input
+// cannot claim a large allocation.
+class CompactDecoder {
+public:
+    CompactDecoder(CompactFormat format, const unsigned char* data, size_t size, const ParseLimits& limits)
+        : m_format(format), m_data(data), m_size(size), m_limits(limits) {}
+
+    // Builds the item into a node keyed "root"
+    ParseError decode(YAMLNode& out);
+
+    // Bytes read, the length of the item once decode() succeeds
+    size_t used() const { return m_position; }
+
+private:
+    struct Item {
+        enum class Kind {
+            Scalar,
+            Mapping,
+            Sequence,
+            Break           // Ends a CBOR collection of indefinite length
+        };
+
+        Kind kind = Kind::Scalar;
+        std::string text;
+        uint64_t size = 0;
+        bool indefinite = false;
+    };
+
+    struct Frame {
+        YAMLNode node;
+        std::string key;
+        uint64_t remaining;     // Entries or items left in a collection of definite length
+        bool indefinite;
+        bool is_mapping;
+        bool expect_key;
+    };
+
+    ParseError readCbor(Item& item);
+    ParseError readCborText(unsigned major, uint64_t length, bool indefinite, std::string& out);
+    ParseError readMessagePack(Item& item);
+
+    bool readBigEndian(size_t bytes, uint64_t& value);
+    bool readBytes(uint64_t length, std::string& out);
+
+    // Adds a finished node to its parent, closing every collection it completes
+    bool complete(std::vector<Frame>& stack, YAMLNode&& node, YAMLNode& out);
+
+    CompactFormat m_format;
+    const unsigned char* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+    ParseLimits m_limits;
+    size_t m_scalar_bytes = 0;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,235 @@
+#include "CompactTranscoder.hpp"
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace EmbedYAML {
+
+namespace {
+
+constexpr unsigned CBOR_UNSIGNED = 0;
+constexpr unsigned CBOR_NEGATIVE = 1;
+constexpr unsigned CBOR_TEXT = 3;
+
+// Writes lead followed by the low bytes of value, most significant first
+void putBigEndian(BlockWriter& out, unsigned char lead, uint64_t value, size_t bytes)
+{
+    char buffer[9];
+    buffer[0] = (char)lead;
+    for (size_t i = 0; i < bytes; ++i)
+        buffer[1 + i] = (char)(value >> (8 * (bytes - 1 - i)));
+    out.put(std::string_view(buffer, 1 + bytes));
+}
+
+// Floats that survive the round trip through single precision take half the bytes
+void putFloat(BlockWriter& out, double value, unsigned char single_lead, unsigned char double_lead)
+{
+    bool single = !std::isfinite(value)
+        || (std::fabs(value) <= std::numeric_limits<float>::max() && (double)(float)value == value);
+
+    if (single) {
+        float narrow = (float)value;
+        uint32_t bits;
+        std::memcpy(&bits, &narrow, sizeof(bits));
+        putBigEndian(out, single_lead, bits, 4);
+    } else {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putBigEndian(out, double_lead, bits, 8);
+    }
+}
+
+void putMessagePackUnsigned(BlockWriter& out, uint64_t value)
+{
+    if (value <= 0x7F)
+        out.put((char)value);
+    else if (value <= 0xFF)
+        putBigEndian(out, 0xCC, value, 1);
+    else if (value <= 0xFFFF)
+        putBigEndian(out, 0xCD, value, 2);
+    else if (value <= 0xFFFFFFFF)
+        putBigEndian(out, 0xCE, value, 4);
+    else
+        putBigEndian(out, 0xCF, value, 8);
+}
+
+void putMessagePackSigned(BlockWriter& out, int64_t value)
+{
+    if (value >= 0)
+        putMessagePackUnsigned(out, (uint64_t)value);
+    else if (value >= -32)
+        out.put((char)value);
+    else if (value >= INT8_MIN)
+        putBigEndian(out, 0xD0, (uint64_t)value, 1);
+    else if (value >= INT16_MIN)
+        putBigEndian(out, 0xD1, (uint64_t)value, 2);
+    else if (value >= INT32_MIN)
+        putBigEndian(out, 0xD2, (uint64_t)value, 4);
+    else
+        putBigEndian(out, 0xD3, (uint64_t)value, 8);
+}
+
+} // namespace
+
+void CborTranscoder::writeKey(std::string_view text)
+{
+    putText(text);
+}
+
+void CborTranscoder::writeScalar(std::string_view text, bool quoted)
+{
+    ScalarValue value = resolveScalar(text, quoted);
+
+    switch (value.type)
+    {
+    case ScalarValue::Type::Null:
+        m_out.put((char)0xF6);
+        break;
+    case ScalarValue::Type::Bool:
+        m_out.put((char)(value.boolean ? 0xF5 : 0xF4));
+        break;
+    case ScalarValue::Type::Int:
+        // Negative integers n are written as -1 - n
+        if (value.integer >= 0)
+            putHead(CBOR_UNSIGNED, (uint64_t)value.integer);
+        else
+            putHead(CBOR_NEGATIVE, ~(uint64_t)value.integer);
+        break;
+    case ScalarValue::Type::UInt:
+        putHead(CBOR_UNSIGNED, value.unsigned_integer);
+        break;
+    case ScalarValue::Type::Float:
+        putFloat(m_out, value.real, 0xFA, 0xFB);
+        break;
+    case ScalarValue::Type::String:
+        putText(text);
+        break;
+    }
+}
+
+void CborTranscoder::writeStart(bool is_mapping)
+{
+    m_out.put((char)(is_mapping ? 0xBF : 0x9F));
+}
+
+void CborTranscoder::writeEnd(bool, size_t)
+{
+    m_out.put((char)0xFF);
+}
+
+ParseError CborTranscoder::outputError() const
+{
+    return m_out.failed() ? ParseError::WriteFailed : ParseError::None;
+}
+
+// Arguments below 24 fit the initial byte, larger ones follow it in 1, 2, 4 or 8 bytes
+void CborTranscoder::putHead(unsigned major, uint64_t argument)
+{
+    unsigned char lead = (unsigned char)(major << 5);
+    if (argument < 24)
+        m_out.put((char)(lead | argument));
+    else if (argument <= 0xFF)
+        putBigEndian(m_out, lead | 24, argument, 1);
+    else if (argument <= 0xFFFF)
+        putBigEndian(m_out, lead | 25, argument, 2);
+    else if (argument <= 0xFFFFFFFF)
+        putBigEndian(m_out, lead | 26, argument, 4);
+    else
+        putBigEndian(m_out, lead | 27, argument, 8);
+}
+
+void CborTranscoder::putText(std::string_view text)
+{
+    putHead(CBOR_TEXT, text.size());
+    m_out.put(text);
+}
+
+void CollectionCounter::writeStart(bool)
+{
+    m_open.push_back(m_counts.size());
+    m_counts.push_back(0);
+}
+
+void CollectionCounter::writeEnd(bool, size_t count)
+{
+    m_counts[m_open.back()] = count;
+    m_open.pop_back();
+}
+
+void MessagePackTranscoder::writeKey(std::string_view text)
+{
+    putText(text);
+}
+
+void MessagePackTranscoder::writeScalar(std::string_view text, bool quoted)
+{
+    ScalarValue value = resolveScalar(text, quoted);
+
+    switch (value.type)
+    {
+    case ScalarValue::Type::Null:
+        m_out.put((char)0xC0);
+        break;
+    case ScalarValue::Type::Bool:
+        m_out.put((char)(value.boolean ? 0xC3 : 0xC2));
+        break;
+    case ScalarValue::Type::Int:
+        putMessagePackSigned(m_out, value.integer);
+        break;
+    case ScalarValue::Type::UInt:
+        putMessagePackUnsigned(m_out, value.unsigned_integer);
+        break;
+    case ScalarValue::Type::Float:
+        putFloat(m_out, value.real, 0xCA, 0xCB);
+        break;
+    case ScalarValue::Type::String:
+        putText(text);
+        break;
+    }
+}
+
+// Collections start in the same order on both passes, so they take their sizes in turn
+void MessagePackTranscoder::writeStart(bool is_mapping)
+{
+    if (m_next == m_counts.size()) {
+        m_unsupported = true;
+        return;
+    }
+
+    size_t size = m_counts[m_next++];
+    if (size < 16)
+        m_out.put((char)((is_mapping ? 0x80 : 0x90) | size));
+    else if (size <= 0xFFFF)
+        putBigEndian(m_out, is_mapping ? 0xDE : 0xDC, size, 2);
+    else if (size <= 0xFFFFFFFF)
+        putBigEndian(m_out, is_mapping ? 0xDF : 0xDD, size, 4);
+    else
+        m_unsupported = true;
+}
+
+ParseError MessagePackTranscoder::outputError() const
+{
+    if (m_unsupported)
+        return ParseError::Unsupported;
+    return m_out.failed() ? ParseError::WriteFailed : ParseError::None;
+}
+
+void MessagePackTranscoder::putText(std::string_view text)
+{
+    size_t size = text.size();
+    if (size < 32)
+        m_out.put((char)(0xA0 | size));
+    else if (size <= 0xFF)
+        putBigEndian(m_out, 0xD9, size, 1);
+    else if (size <= 0xFFFF)
+        putBigEndian(m_out, 0xDA, size, 2);
+    else if (size <= 0xFFFFFFFF)
+        putBigEndian(m_out, 0xDB, size, 4);
+    else
+        m_unsupported = true;
+
+    if (!m_unsupported)
+        m_out.put(text);
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "EmbedYAML/BlockWriter.hpp"
+#include "Transcoder.hpp"
+#include <cstdint>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Writes every document as one CBOR data item (RFC 8949), so a stream becomes a CBOR
+// sequence. Collections have indefinite length, which needs no count ahead of the entries.
+class CborTranscoder : public Transcoder {
+public:
+    CborTranscoder(BlockWriter& out, const ParseLimits& limits) : Transcoder(limits), m_out(out) {}
+
+protected:
+    void writeKey(std::string_view text) override;
+    void writeScalar(std::string_view text, bool quoted) override;
+    void writeStart(bool is_mapping) override;
+    void writeEnd(bool is_mapping, size_t count) override;
+    ParseError outputError() const override;
+
+private:
+    void putHead(unsigned major, uint64_t argument);
+    void putText(std::string_view text);
+
+    BlockWriter& m_out;
+};
+
+// Records the size of every collection in the order they start, for MessagePack to write
+// ahead of the entries
+class CollectionCounter : public Transcoder {
+public:
+    CollectionCounter(const ParseLimits& limits, std::vector<size_t>& counts) : Transcoder(limits), m_counts(counts) {}
+
+protected:
+    void writeKey(std::string_view) override {}
+    void writeScalar(std::string_view, bool) override {}
+    void writeStart(bool is_mapping) override;
+    void writeEnd(bool is_mapping, size_t count) override;
+    ParseError outputError() const override { return ParseError::None; }
+
+private:
+    std::vector<size_t>& m_counts;
+    std::vector<size_t> m_open;
+};
+
+// Writes every document as one MessagePack object, taking collection sizes from a
+// CollectionCounter run over the same input. Text or collections over 2^32 - 1 bytes or
+// entries have no MessagePack form and end the document with Unsupported.
+class MessagePackTranscoder : public Transcoder {
+public:
+    MessagePackTranscoder(BlockWriter& out, const ParseLimits& limits, const std::vector<size_t>& counts)
+        : Transcoder(limits), m_out(out), m_counts(counts) {}
+
+protected:
+    void writeKey(std::string_view text) override;
+    void writeScalar(std::string_view text, bool quoted) override;
+    void writeStart(bool is_mapping) override;
+    void writeEnd(bool, size_t) override {}
+    ParseError outputError() const override;
+
+private:
+    void putText(std::string_view text);
+
+    BlockWriter& m_out;
+    const std::vector<size_t>& m_counts;
+    size_t m_next = 0;
+    bool m_unsupported = false;
+};
+
+} // namespace EmbedYAML
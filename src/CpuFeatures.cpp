@@ -0,0 +1,27 @@
+#include "CpuFeatures.hpp"
+
+namespace EmbedYAML {
+
+namespace {
+
+SimdLevel detectSimdLevel()
+{
+#ifdef EMBEDYAML_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Portable;
+}
+
+} // namespace
+
+SimdLevel simdLevel()
+{
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,19 @@
+#pragma once
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define EMBEDYAML_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace EmbedYAML {
+
+// Widest vector instruction set usable on this CPU, detected once
+enum class SimdLevel {
+    Portable,
+    SSE2,
+    AVX2
+};
+
+SimdLevel simdLevel();
+
+} // namespace EmbedYAML
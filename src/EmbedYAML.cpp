@@ -1,9 +1,63 @@
 #include "EmbedYAML/EmbedYAML.hpp"
+#include "CompactDecoder.hpp"
+#include "CompactTranscoder.hpp"
+#include "InputScan.hpp"
+#include "JsonTranscoder.hpp"
+#include "LibyamlAllocator.hpp"
+#include "NativeScanner.hpp"
+#include "Pipeline.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
+#include "YAMLTreeBuilder.hpp"
+#include <deque>
+#include <future>
 
 namespace EmbedYAML {
 
 void print_event(yaml_event_t event);
 
+namespace {
+
+// Builds the root node of the first document, false on a parser error, a limit or an
+// empty stream. Root is left untouched unless a document was started.
+bool buildRoot(YAMLEventReader& reader, YAMLTreeBuilder& builder, YAMLNode& root)
+{
+    while (reader.next())
+    {
+        if (reader.type() == YAML_STREAM_START_EVENT || reader.type() == YAML_DOCUMENT_START_EVENT)
+            continue;
+
+        if (reader.type() == YAML_STREAM_END_EVENT)
+            return false;
+
+        bool complete = builder.run(reader);
+        root = std::move(builder.result());
+        return complete;
+    }
+
+    builder.fail(reader.error());
+    return false;
+}
+
+bool exceeds(size_t value, size_t limit)
+{
+    return limit && value > limit;
+}
+
+// Slices are each held to the limits while they parse, their sum is checked afterwards
+ParseError checkTotals(const ParseUsage& usage, const ParseLimits& limits)
+{
+    if (exceeds(usage.nodes, limits.max_nodes))
+        return ParseError::TooManyNodes;
+    if (exceeds(usage.scalar_bytes, limits.max_scalar_bytes))
+        return ParseError::ScalarBytesExceeded;
+    if (exceeds(usage.alias_expansions, limits.max_alias_expansions))
+        return ParseError::AliasExpansionsExceeded;
+    return ParseError::None;
+}
+
+} // namespace
+
 EmbedYAML::EmbedYAML(EYFileOpenFunction open,
                      EYFileCloseFunction close,
                      EYReadCharFunction read_char,
@@ -20,106 +74,515 @@ EmbedYAML::~EmbedYAML()
 }
 
 YAMLNode EmbedYAML::parseFile(std::string filename)
+{
+    m_last_error = ParseError::None;
+    m_schema_report = SchemaReport();
+    m_allocation_stats = AllocationStats();
+
+    EMBEDYAML_TRY {
+        return parseSource(filename);
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return YAMLNode("root");
+}
+
+YAMLNode EmbedYAML::parseBuffer(const char* data, size_t length)
+{
+    m_last_error = ParseError::None;
+    m_schema_report = SchemaReport();
+    m_allocation_stats = AllocationStats();
+
+    EMBEDYAML_TRY {
+        return parseInput(data, length);
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return YAMLNode("root");
+}
+
+YAMLNode EmbedYAML::parseSource(const std::string& filename)
 {
     YAMLNode root("root");
-    std::stack<YAMLNode*> node_stack;
-    node_stack.push(&root);
 
-    if (m_file_open_function(this, filename) < 0)
+    if (m_parse_options.parallel_split || m_parse_options.native_scanner) {
+        std::string input;
+        if (!readFile(filename, input))
+            return root;
+
+        return parseInput(input.data(), input.size());
+    }
+
+    YAMLEventReader reader(this, filename, &m_allocation_stats);
+    if (!reader.isOpen()) {
+        m_last_error = reader.error() != ParseError::None ? reader.error() : ParseError::OpenFailed;
         return root;
+    }
 
-        yaml_parser_t parser;
-    yaml_parser_initialize(&parser);
+    YAMLTreeBuilder builder("root", m_parse_options.limits);
+    builder.setSchema(m_parse_options.schema.get());
+    if (m_parse_options.pipelined)
+        buildRootPipelined(reader, builder, root, m_parse_options.pipeline_capacity);
+    else
+        buildRoot(reader, builder, root);
 
-    yaml_parser_set_input(
-        &parser,
-        [](void* ext, unsigned char* buffer, size_t size, size_t* length) -> int
-        {
-            auto ey = (EmbedYAML*)ext;
-            *length = 0;
-
-            for (size_t i = 0; i < size; ++i) {
-                auto c = ey->m_read_char_function(ey);
-                if (!c.has_value()) {
-                    // Return success with fewer bytes read if we're at the end
-                    return 1; 
-                }
-                buffer[i] = c.value();
-                (*length)++;
-            }
+    m_last_error = builder.error();
+    m_schema_report = builder.schemaReport();
+    return root;
+}
 
-            return 1;
-        },
-        this
-    );
+bool EmbedYAML::transcodeJsonFile(std::string filename, BlockWriter& out)
+{
+    m_last_error = ParseError::None;
+    m_allocation_stats = AllocationStats();
 
-    bool mapping_started = true;
-    std::string key = "";
-    std::string value = "";
+    EMBEDYAML_TRY {
+        YAMLEventReader reader(this, std::move(filename), &m_allocation_stats);
+        if (!openedReader(reader))
+            return false;
 
-    bool done = false;
-    bool whole_map_started = false;
-    while(!done)
-    {
-        yaml_event_t event;
-        if (!yaml_parser_parse(&parser, &event)) {
-            fprintf(stderr, "parser error %d\n", parser.error);
-            break;
+        JsonTranscoder transcoder(out, m_parse_options.limits);
+        return transcode(transcoder, reader, out);
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return false;
+}
+
+bool EmbedYAML::transcodeJsonBuffer(const char* data, size_t length, BlockWriter& out)
+{
+    m_last_error = ParseError::None;
+    m_allocation_stats = AllocationStats();
+
+    if (exceeds(length, m_parse_options.limits.max_input_bytes)) {
+        m_last_error = ParseError::InputTooLarge;
+        return false;
+    }
+
+    EMBEDYAML_TRY {
+        YAMLEventReader reader(data, length, &m_allocation_stats);
+        if (!openedReader(reader))
+            return false;
+
+        JsonTranscoder transcoder(out, m_parse_options.limits);
+        return transcode(transcoder, reader, out);
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return false;
+}
+
+bool EmbedYAML::transcodeCompactFile(std::string filename, CompactFormat format, BlockWriter& out)
+{
+    m_last_error = ParseError::None;
+    m_allocation_stats = AllocationStats();
+
+    return transcodeCompact([&]() { return std::make_unique<YAMLEventReader>(this, filename, &m_allocation_stats); },
+                            format, out);
+}
+
+bool EmbedYAML::transcodeCompactBuffer(const char* data, size_t length, CompactFormat format, BlockWriter& out)
+{
+    m_last_error = ParseError::None;
+    m_allocation_stats = AllocationStats();
+
+    if (exceeds(length, m_parse_options.limits.max_input_bytes)) {
+        m_last_error = ParseError::InputTooLarge;
+        return false;
+    }
+
+    return transcodeCompact([&]() { return std::make_unique<YAMLEventReader>(data, length, &m_allocation_stats); },
+                            format, out);
+}
+
+YAMLNode EmbedYAML::decodeCompactBuffer(const char* data, size_t length, CompactFormat format, size_t* used)
+{
+    m_last_error = ParseError::None;
+    m_allocation_stats = AllocationStats();
+    if (used)
+        *used = 0;
+
+    if (exceeds(length, m_parse_options.limits.max_input_bytes)) {
+        m_last_error = ParseError::InputTooLarge;
+        return YAMLNode("root");
+    }
+
+    EMBEDYAML_TRY {
+        CompactDecoder decoder(format, (const unsigned char*)data, length, m_parse_options.limits);
+        YAMLNode root;
+        m_last_error = decoder.decode(root);
+        if (m_last_error != ParseError::None)
+            return YAMLNode("root");
+
+        if (used)
+            *used = decoder.used();
+        return root;
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return YAMLNode("root");
+}
+
+// MessagePack needs the size of every collection before its entries, which a first pass
+// over the input collects
+bool EmbedYAML::transcodeCompact(const std::function<std::unique_ptr<YAMLEventReader>()>& open, CompactFormat format,
+                                 BlockWriter& out)
+{
+    std::vector<size_t> counts;
+    EMBEDYAML_TRY {
+        if (format == CompactFormat::MessagePack) {
+            std::unique_ptr<YAMLEventReader> reader = open();
+            if (!openedReader(*reader))
+                return false;
+
+            CollectionCounter counter(m_parse_options.limits, counts);
+            m_last_error = counter.run(*reader);
+            if (m_last_error != ParseError::None)
+                return false;
+        }
+
+        std::unique_ptr<YAMLEventReader> reader = open();
+        if (!openedReader(*reader))
+            return false;
+
+        if (format == CompactFormat::CBOR) {
+            CborTranscoder transcoder(out, m_parse_options.limits);
+            return transcode(transcoder, *reader, out);
         }
+        MessagePackTranscoder transcoder(out, m_parse_options.limits, counts);
+        return transcode(transcoder, *reader, out);
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        m_last_error = ParseError::OutOfMemory;
+    }
+    return false;
+}
+
+bool EmbedYAML::openedReader(const YAMLEventReader& reader)
+{
+    if (!reader.isOpen())
+        m_last_error = reader.error() != ParseError::None ? reader.error() : ParseError::OpenFailed;
+    return reader.isOpen();
+}
+
+// A failed write shows once the buffer fills, so it can stop the transcoder mid-document
+bool EmbedYAML::transcode(Transcoder& transcoder, YAMLEventReader& reader, BlockWriter& out)
+{
+    m_last_error = transcoder.run(reader);
 
-        print_event(event);
+    if (out.failed() || (m_last_error == ParseError::None && !out.flush()))
+        m_last_error = ParseError::WriteFailed;
+    return m_last_error == ParseError::None;
+}
+
+YAMLSequenceStream EmbedYAML::streamSequence(std::string filename, std::string key)
+{
+    return YAMLSequenceStream(this, std::move(filename), std::move(key));
+}
+
+YAMLDocumentStream EmbedYAML::parseDocuments(std::string filename)
+{
+    return YAMLDocumentStream(this, std::move(filename));
+}
+
+YAMLParallelDocumentStream EmbedYAML::parseDocumentsParallel(std::string filename, unsigned threads)
+{
+    std::string input;
+    ParseError read_error = readFile(filename, input) ? ParseError::None : m_last_error;
+
+    return YAMLParallelDocumentStream(std::move(input), threads, m_parse_options.limits, read_error);
+}
 
-        switch (event.type)
+YAMLNode EmbedYAML::parseInput(const char* data, size_t length)
+{
+    const ParseLimits& limits = m_parse_options.limits;
+    if (exceeds(length, limits.max_input_bytes)) {
+        m_last_error = ParseError::InputTooLarge;
+        return YAMLNode("root");
+    }
+
+    // Malformed input goes to libyaml untouched so it reports the error
+    std::string transcoded;
+    bool validated = prepareInput(data, length, transcoded);
+
+    // parseFile() and parseBuffer() both end up here, and neither splits unless parallel_split
+    // is set. A few slices per thread keeps workers busy when entries differ in size.
+    InputSlices slices;
+    unsigned threads = 0;
+    if (m_parse_options.parallel_split && validated && length >= m_parse_options.parallel_min_bytes
+        && !m_parse_options.schema) {
+        threads = m_parse_options.threads ? m_parse_options.threads : ThreadPool::defaultThreads();
+        if (threads > 1)
+            slices = splitTopLevelKeys(data, length, threads * 4);
+    }
+
+    std::vector<YAMLNode> parts(slices.size());
+    std::vector<AllocationStats> slice_stats(slices.size());
+    std::deque<YAMLTreeBuilder> builders;
+    bool split = !slices.empty();
+    EmbedYAML* ey = this;
+
+    if (split) {
+        std::vector<std::future<bool>> results;
+        ThreadPool pool(threads);
+
+        for (size_t i = 0; i < slices.size(); ++i) {
+            builders.emplace_back("root", limits);
+
+            auto task = std::make_shared<std::packaged_task<bool()>>(
+                [ey, data, &slices, &parts, &slice_stats, &builders, i] {
+                    return ey->buildBufferRoot(data + slices[i].first, slices[i].second - slices[i].first,
+                                               builders[i], parts[i], true, slice_stats[i])
+                        && parts[i].isMapping();
+                });
+
+            results.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+
+        for (auto& result : results)
+            split = result.get() && split;
+    }
+
+    // Slices parsed before a fallback still count towards the parse
+    for (const auto& stats : slice_stats)
+        m_allocation_stats += stats;
+
+    // Slices count their limits apart, so the sums are checked here
+    ParseUsage total;
+    for (const auto& builder : builders) {
+        total.nodes += builder.usage().nodes;
+        total.scalar_bytes += builder.usage().scalar_bytes;
+        total.alias_expansions += builder.usage().alias_expansions;
+    }
+
+    // Any slice that did not yield a clean mapping is reparsed as a whole. So is input over
+    // the limits, which returns the partial tree of a sequential parse and stops at the limit.
+    if (split && checkTotals(total, limits) != ParseError::None)
+        split = false;
+
+    if (!split) {
+        YAMLNode root("root");
+        YAMLTreeBuilder builder("root", limits);
+        builder.setSchema(m_parse_options.schema.get());
+        buildBufferRoot(data, length, builder, root, validated, m_allocation_stats);
+        m_last_error = builder.error();
+        m_schema_report = builder.schemaReport();
+        return root;
+    }
+
+    YAMLNode root = std::move(parts[0]);
+    for (size_t i = 1; i < parts.size(); ++i) {
+        for (size_t j = 0; j < parts[i].size(); ++j)
+            root.addNode(std::move(parts[i][j]));
+        parts[i] = YAMLNode();
+    }
+
+    return root;
+}
+
+bool EmbedYAML::buildBufferRoot(const char* data, size_t length, YAMLTreeBuilder& builder, YAMLNode& root, bool validated,
+                                AllocationStats& stats)
+{
+    if (m_parse_options.native_scanner) {
+        switch (parseNative(data, length, builder, validated))
         {
-        case YAML_SCALAR_EVENT:
-            {
-                if (mapping_started) {
-                    node_stack.top()->addSequence((char*)event.data.scalar.value, std::vector<YAMLNode>());
-                    node_stack.push(&node_stack.top()->operator[]((char*)event.data.scalar.value));
-                    std::cout << "Map: " << (char*)event.data.scalar.value << std::endl;
-                    mapping_started = false;
-                } else {
-                    if (key.empty()) {
-                        key = (char*)event.data.scalar.value;
-                    } else {
-                        value = (char*)event.data.scalar.value;
-                        node_stack.top()->addScalar(key, value);
-                        std::cout << "Scalar: " << key << " = " << value << std::endl;
-                        key = "";
-                        value = "";
-                    }
-                }
-            }
+        case NativeResult::Complete:
+            root = std::move(builder.result());
+            return true;
+        case NativeResult::Rejected:
+            root = std::move(builder.result());
+            return false;
+        case NativeResult::Empty:
+            return false;
+        case NativeResult::Unsupported:
+            builder.reset();
             break;
-        case YAML_MAPPING_START_EVENT:
-        case YAML_SEQUENCE_START_EVENT:
-            {
-                // if(whole_map_started)
-                //     mapping_started = true;
-                // else
-                //     whole_map_started = true;
-            }
-            break;
-        case YAML_MAPPING_END_EVENT:
-        case YAML_SEQUENCE_END_EVENT:
-            {
-                node_stack.pop();
+        }
+    }
+
+    YAMLEventReader reader(data, length, &stats);
+    return buildRoot(reader, builder, root);
+}
+
+// Reads at most one byte past max_input_bytes, so callers can tell the input was cut short
+bool EmbedYAML::readFile(const std::string& filename, std::string& out)
+{
+    out.clear();
+
+    if (m_file_open_function(this, filename) < 0) {
+        m_last_error = ParseError::OpenFailed;
+        return false;
+    }
+
+    size_t max_bytes = m_parse_options.limits.max_input_bytes;
+    bool complete = true;
+
+    // Read a block at a time, through the block callback when there is one
+    char block[4096];
+    for (;;) {
+        size_t length = 0;
+        if (m_read_block_function) {
+            length = m_read_block_function(this, block, sizeof(block));
+        } else {
+            while (length < sizeof(block)) {
+                auto c = m_read_char_function(this);
+                if (!c)
+                    break;
+                block[length++] = c.value();
             }
+        }
+        if (length == 0)
             break;
-        default:
+
+        out.append(block, length);
+        if (exceeds(out.size(), max_bytes)) {
+            m_last_error = ParseError::InputTooLarge;
+            complete = false;
             break;
         }
+    }
+
+    m_file_close_function(this, filename);
+    return complete;
+}
 
-        done = (event.type == YAML_STREAM_END_EVENT);
-        yaml_event_delete(&event);
+int EmbedYAML::readHandler(void* ext, unsigned char* buffer, size_t size, size_t* length)
+{
+    auto reader = (YAMLEventReader*)ext;
+    auto ey = reader->m_ey;
+    *length = 0;
+
+    if (ey->m_read_block_function) {
+        *length = ey->m_read_block_function(ey, (char*)buffer, size);
+
+        // Failing the read makes libyaml stop with a reader error
+        reader->m_bytes_read += *length;
+        if (exceeds(reader->m_bytes_read, reader->m_max_input_bytes)) {
+            reader->m_input_exceeded = true;
+            return 0;
+        }
+        return 1;
     }
 
-    yaml_parser_delete(&parser);
+    for (size_t i = 0; i < size; ++i) {
+        auto c = ey->m_read_char_function(ey);
+        if (!c.has_value()) {
+            // Return success with fewer bytes read if we're at the end
+            return 1; 
+        }
 
-    if (m_file_close_function(this, filename) < 0)
-        return root;
+        // Failing the read makes libyaml stop with a reader error
+        if (exceeds(++reader->m_bytes_read, reader->m_max_input_bytes)) {
+            reader->m_input_exceeded = true;
+            return 0;
+        }
 
-    return root;
+        buffer[i] = c.value();
+        (*length)++;
+    }
+
+    return 1;
+}
+
+YAMLEventReader::YAMLEventReader(EmbedYAML* ey, std::string filename, AllocationStats* stats)
+    : m_ey(ey),
+      m_filename(std::move(filename)),
+      m_stats(stats)
+{
+    m_event.type = YAML_NO_EVENT;
+
+    if (m_ey->m_file_open_function(m_ey, m_filename) < 0)
+        return;
+
+    m_max_input_bytes = m_ey->m_parse_options.limits.max_input_bytes;
+
+    AllocationScope scope(m_stats);
+    if (!yaml_parser_initialize(&m_parser)) {
+        m_ey->m_file_close_function(m_ey, m_filename);
+        m_out_of_memory = true;
+        return;
+    }
+    yaml_parser_set_input(&m_parser, &EmbedYAML::readHandler, this);
+    m_open = true;
+}
+
+YAMLEventReader::YAMLEventReader(const char* data, size_t length, AllocationStats* stats)
+    : m_ey(nullptr),
+      m_stats(stats)
+{
+    m_event.type = YAML_NO_EVENT;
+
+    AllocationScope scope(m_stats);
+    if (!yaml_parser_initialize(&m_parser)) {
+        m_out_of_memory = true;
+        return;
+    }
+    yaml_parser_set_input_string(&m_parser, (const unsigned char*)data, length);
+    m_open = true;
+}
+
+YAMLEventReader::~YAMLEventReader()
+{
+    if (!m_open)
+        return;
+
+    AllocationScope scope(m_stats);
+    if (m_has_event)
+        yaml_event_delete(&m_event);
+
+    yaml_parser_delete(&m_parser);
+    if (m_ey)
+        m_ey->m_file_close_function(m_ey, m_filename);
+}
+
+bool YAMLEventReader::next()
+{
+    if (!m_open || m_failed)
+        return false;
+
+    // Scoped per call, since a pipelined reader is driven from its own thread
+    AllocationScope scope(m_stats);
+    if (m_has_event) {
+        bool stream_end = (m_event.type == YAML_STREAM_END_EVENT);
+        yaml_event_delete(&m_event);
+        m_has_event = false;
+        if (stream_end)
+            return false;
+    }
+
+    // Reported through failed() and error(), the library never prints
+    if (!yaml_parser_parse(&m_parser, &m_event)) {
+        m_event.type = YAML_NO_EVENT;
+        m_failed = true;
+        return false;
+    }
+
+    m_has_event = true;
+
+#ifdef EMBEDYAML_DEBUG
+    print_event(m_event);
+#endif
+
+    return true;
+}
+
+bool YAMLEventReader::skipNode()
+{
+    if (type() != YAML_MAPPING_START_EVENT && type() != YAML_SEQUENCE_START_EVENT)
+        return true;
+
+    size_t depth = 1;
+    while (depth > 0) {
+        if (!next())
+            return false;
+
+        if (type() == YAML_MAPPING_START_EVENT || type() == YAML_SEQUENCE_START_EVENT)
+            depth++;
+        else if (type() == YAML_MAPPING_END_EVENT || type() == YAML_SEQUENCE_END_EVENT)
+            depth--;
+    }
+
+    return true;
 }
 
 void print_event(yaml_event_t event)
@@ -0,0 +1,310 @@
+#include "InputScan.hpp"
+#include <cstring>
+#include <string>
+#include <unordered_map>
+
+namespace EmbedYAML {
+
+namespace {
+
+bool isMarker(const char* line, const char* end, char c)
+{
+    if (end - line < 3 || line[0] != c || line[1] != c || line[2] != c)
+        return false;
+
+    return end - line == 3 || line[3] == ' ' || line[3] == '\t' || line[3] == '\r' || line[3] == '\n';
+}
+
+// Line classification for the top-level key scan
+enum class LineKind {
+    Blank,
+    Content,
+    BlockScalar,
+    Unsafe
+};
+
+// Finds column-0 mapping keys and the anchors and aliases between them.
+// Anything the scan cannot reason about line by line marks the input unsafe.
+class TopLevelScanner {
+public:
+    bool scan(const char* data, size_t length);
+
+    std::vector<size_t> keys;                               // Offsets of column-0 key lines
+    std::vector<std::pair<size_t, size_t>> references;      // Anchor and alias key indices
+
+private:
+    LineKind scanLine(const char* line, const char* end, bool& header);
+    const char* skipQuoted(const char* p, const char* end);
+
+    const char* m_base = nullptr;
+    std::unordered_map<std::string, size_t> m_anchors;
+};
+
+bool TopLevelScanner::scan(const char* data, size_t length)
+{
+    const char* end = data + length;
+    const char* line = data;
+    m_base = data;
+    size_t block_indent = 0;
+    bool in_block = false;
+    bool header = true;
+
+    while (line < end) {
+        const char* eol = (const char*)std::memchr(line, '\n', end - line);
+        const char* next = eol ? eol + 1 : end;
+        const char* content_end = eol ? eol : end;
+        if (content_end > line && content_end[-1] == '\r')
+            content_end--;
+
+        size_t indent = 0;
+        while (line + indent < content_end && line[indent] == ' ')
+            indent++;
+
+        // Block scalar content is opaque, it ends at the first line not indented past its header
+        if (in_block && (line + indent == content_end || indent > block_indent)) {
+            line = next;
+            continue;
+        }
+        in_block = false;
+
+        switch (scanLine(line, content_end, header)) {
+        case LineKind::Unsafe:
+            return false;
+        case LineKind::BlockScalar:
+            in_block = true;
+            block_indent = indent;
+            break;
+        default:
+            break;
+        }
+
+        line = next;
+    }
+
+    return true;
+}
+
+LineKind TopLevelScanner::scanLine(const char* line, const char* end, bool& header)
+{
+    const char* p = line;
+    while (p < end && *p == ' ')
+        p++;
+
+    if (p == end || *p == '#')
+        return LineKind::Blank;
+
+    bool key_line = (p == line);
+    if (key_line) {
+        // A bare document start may only precede the root mapping
+        if (isMarker(line, end, '-')) {
+            const char* rest = line + 3;
+            while (rest < end && (*rest == ' ' || *rest == '\t'))
+                rest++;
+            return header && (rest == end || *rest == '#') ? LineKind::Blank : LineKind::Unsafe;
+        }
+
+        // Directives, markers, root sequences, flow and complex keys
+        if (std::strchr("%.-?[{|>&*!@`,]}", *p))
+            return LineKind::Unsafe;
+
+        keys.push_back(line - m_base);
+    } else if (keys.empty()) {
+        return LineKind::Unsafe;
+    }
+    header = false;
+
+    size_t key_index = keys.size() - 1;
+    bool scalar_start = true;
+    bool mapping_indicator = false;
+    int flow = 0;
+
+    for (; p < end; ++p) {
+        char c = *p;
+        if (c == ' ' || c == '\t')
+            continue;
+
+        if (c == '#' && (p[-1] == ' ' || p[-1] == '\t'))
+            break;
+
+        if (scalar_start) {
+            if (c == '"' || c == '\'') {
+                p = skipQuoted(p, end);
+                if (!p)
+                    return LineKind::Unsafe;
+                scalar_start = false;
+                continue;
+            }
+
+            if (c == '&' || c == '*') {
+                const char* name = p + 1;
+                while (p + 1 < end && !std::strchr(" \t,[]{}", p[1]))
+                    p++;
+
+                std::string anchor(name, p + 1);
+                if (anchor.empty())
+                    return LineKind::Unsafe;
+
+                if (c == '&') {
+                    m_anchors[anchor] = key_index;
+                } else {
+                    auto it = m_anchors.find(anchor);
+                    if (it == m_anchors.end())
+                        return LineKind::Unsafe;
+                    references.emplace_back(it->second, key_index);
+                    scalar_start = false;
+                }
+                continue;
+            }
+
+            if (c == '!') {
+                while (p + 1 < end && p[1] != ' ' && p[1] != '\t')
+                    p++;
+                continue;
+            }
+
+            if ((c == '|' || c == '>') && flow == 0)
+                return LineKind::BlockScalar;
+
+            if (c == '[' || c == '{') {
+                flow++;
+                continue;
+            }
+
+            if ((c == '-' || c == '?') && (p + 1 == end || p[1] == ' ' || p[1] == '\t')) {
+                if (c == '?')
+                    return LineKind::Unsafe;
+                continue;
+            }
+        }
+
+        if (flow > 0) {
+            if (c == ']' || c == '}') {
+                flow--;
+                scalar_start = false;
+                continue;
+            }
+            if (c == ',') {
+                scalar_start = true;
+                continue;
+            }
+        }
+
+        if (c == ':' && (p + 1 == end || p[1] == ' ' || p[1] == '\t'
+                         || (flow > 0 && std::strchr(",[]{}", p[1])))) {
+            if (flow == 0)
+                mapping_indicator = true;
+            scalar_start = true;
+            continue;
+        }
+
+        scalar_start = false;
+    }
+
+    // Flow collections spanning lines and column-0 lines that are not keys
+    if (flow > 0 || (key_line && !mapping_indicator))
+        return LineKind::Unsafe;
+
+    return LineKind::Content;
+}
+
+// Returns the closing quote, or null when the scalar continues on the next line
+const char* TopLevelScanner::skipQuoted(const char* p, const char* end)
+{
+    char quote = *p;
+    for (++p; p < end; ++p) {
+        if (quote == '"' && *p == '\\') {
+            p++;
+            continue;
+        }
+        if (*p == quote) {
+            if (quote == '\'' && p + 1 < end && p[1] == '\'') {
+                p++;
+                continue;
+            }
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+InputSlices findDocuments(const char* data, size_t length)
+{
+    // Document markers at column 0 are forbidden inside block, quoted and plain
+    // scalars alike, so libyaml ends whatever it is scanning there as well.
+    // Only directives need care since they belong to the document that follows.
+    InputSlices slices;
+    const char* end = data + length;
+    const char* line = data;
+    size_t start = 0;
+    size_t directives = length;
+
+    while (line < end) {
+        const char* eol = (const char*)std::memchr(line, '\n', end - line);
+        const char* next = eol ? eol + 1 : end;
+        size_t offset = line - data;
+
+        if (*line == '%') {
+            if (directives == length)
+                directives = offset;
+        } else if (isMarker(line, next, '-')) {
+            size_t cut = directives < offset ? directives : offset;
+            if (cut > start)
+                slices.emplace_back(start, cut);
+            start = cut;
+            directives = length;
+        } else if (isMarker(line, next, '.')) {
+            size_t cut = next - data;
+            slices.emplace_back(start, cut);
+            start = cut;
+            directives = length;
+        }
+
+        line = next;
+    }
+
+    if (start < length)
+        slices.emplace_back(start, length);
+
+    return slices;
+}
+
+InputSlices splitTopLevelKeys(const char* data, size_t length, size_t max_slices)
+{
+    TopLevelScanner scanner;
+    if (!scanner.scan(data, length) || scanner.keys.size() < 2 || max_slices < 2)
+        return InputSlices();
+
+    // Never cut between an anchor and the aliases that refer to it
+    std::vector<int> blocked(scanner.keys.size() + 1, 0);
+    for (auto& reference : scanner.references) {
+        if (reference.first < reference.second) {
+            blocked[reference.first + 1]++;
+            blocked[reference.second + 1]--;
+        }
+    }
+
+    InputSlices slices;
+    size_t target = length / max_slices;
+    size_t start = 0;
+    int open_references = 0;
+
+    for (size_t i = 1; i < scanner.keys.size(); ++i) {
+        open_references += blocked[i];
+        size_t cut = scanner.keys[i];
+
+        if (open_references == 0 && cut - start >= target && slices.size() + 1 < max_slices) {
+            slices.emplace_back(start, cut);
+            start = cut;
+        }
+    }
+    slices.emplace_back(start, length);
+
+    if (slices.size() < 2)
+        return InputSlices();
+
+    return slices;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Byte ranges [begin, end) of an in-memory buffer
+using InputSlices = std::vector<std::pair<size_t, size_t>>;
+
+// Splits a multi-document stream into one slice per document
+InputSlices findDocuments(const char* data, size_t length);
+
+// Splits a root block mapping into at most max_slices runs of whole top-level
+// entries, or returns no slices when the input cannot be split safely
+InputSlices splitTopLevelKeys(const char* data, size_t length, size_t max_slices);
+
+} // namespace EmbedYAML
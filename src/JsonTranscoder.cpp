@@ -0,0 +1,262 @@
+#include "JsonTranscoder.hpp"
+#include "CpuFeatures.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+namespace EmbedYAML {
+
+namespace {
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Text JSON reads as the same number, which is copied without converting it
+bool isJsonNumber(std::string_view text)
+{
+    size_t i = 0;
+    size_t n = text.size();
+    if (i < n && text[i] == '-')
+        i++;
+
+    if (i < n && text[i] == '0') {
+        i++;
+    } else {
+        if (i == n || !isDigit(text[i]))
+            return false;
+        while (i < n && isDigit(text[i]))
+            i++;
+    }
+
+    if (i < n && text[i] == '.') {
+        i++;
+        if (i == n || !isDigit(text[i]))
+            return false;
+        while (i < n && isDigit(text[i]))
+            i++;
+    }
+
+    if (i < n && (text[i] == 'e' || text[i] == 'E')) {
+        i++;
+        if (i < n && (text[i] == '+' || text[i] == '-'))
+            i++;
+        if (i == n || !isDigit(text[i]))
+            return false;
+        while (i < n && isDigit(text[i]))
+            i++;
+    }
+
+    return i == n;
+}
+
+// Length of the run of bytes that go into a JSON string as they are, up to the first
+// control character, quote or backslash
+using CleanPrefixFunction = size_t (*)(const unsigned char* data, size_t length);
+
+bool needsEscape(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+size_t cleanPrefixPortable(const unsigned char* data, size_t length)
+{
+    for (size_t i = 0; i < length; ++i) {
+        if (needsEscape(data[i]))
+            return i;
+    }
+    return length;
+}
+
+#ifdef EMBEDYAML_X86_KERNELS
+
+// Unsigned max against 0x1F leaves exactly the control characters unchanged
+__attribute__((target("sse2")))
+size_t cleanPrefixSSE2(const unsigned char* data, size_t length)
+{
+    const __m128i controls = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i special = _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(chunk, controls), controls),
+                                       _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(special);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+
+    return i + cleanPrefixPortable(data + i, length - i);
+}
+
+__attribute__((target("avx2")))
+size_t cleanPrefixAVX2(const unsigned char* data, size_t length)
+{
+    const __m256i controls = _mm256_set1_epi8(0x1F);
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(chunk, controls), controls),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                                          _mm256_cmpeq_epi8(chunk, backslash)));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(special);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+
+    return i + cleanPrefixPortable(data + i, length - i);
+}
+
+#endif
+
+CleanPrefixFunction selectKernel()
+{
+    switch (simdLevel())
+    {
+#ifdef EMBEDYAML_X86_KERNELS
+    case SimdLevel::AVX2:
+        return cleanPrefixAVX2;
+    case SimdLevel::SSE2:
+        return cleanPrefixSSE2;
+#endif
+    default:
+        return cleanPrefixPortable;
+    }
+}
+
+} // namespace
+
+void JsonTranscoder::writeKey(std::string_view text)
+{
+    putString(text);
+    m_out.put(':');
+}
+
+// Numbers JSON reads as they are spelled are copied, others such as 0x1F, +5 or 1. are
+// written in their shortest decimal form
+void JsonTranscoder::writeScalar(std::string_view text, bool quoted)
+{
+    ScalarValue value = resolveScalar(text, quoted);
+    char number[32];
+    std::to_chars_result result{};
+
+    switch (value.type)
+    {
+    case ScalarValue::Type::Null:
+        m_out.put("null");
+        return;
+    case ScalarValue::Type::Bool:
+        m_out.put(value.boolean ? "true" : "false");
+        return;
+    case ScalarValue::Type::String:
+        putString(text);
+        return;
+    case ScalarValue::Type::Int:
+        result = std::to_chars(number, number + sizeof(number), value.integer);
+        break;
+    case ScalarValue::Type::UInt:
+        result = std::to_chars(number, number + sizeof(number), value.unsigned_integer);
+        break;
+    case ScalarValue::Type::Float:
+        // JSON has no number for .inf or .nan
+        if (!std::isfinite(value.real)) {
+            putString(text);
+            return;
+        }
+        result = std::to_chars(number, number + sizeof(number), value.real);
+        break;
+    }
+
+    if (isJsonNumber(text))
+        m_out.put(text);
+    else
+        m_out.put(std::string_view(number, result.ptr - number));
+}
+
+void JsonTranscoder::writeStart(bool is_mapping)
+{
+    m_out.put(is_mapping ? '{' : '[');
+}
+
+void JsonTranscoder::writeEnd(bool is_mapping, size_t)
+{
+    m_out.put(is_mapping ? '}' : ']');
+}
+
+void JsonTranscoder::writeSeparator()
+{
+    m_out.put(',');
+}
+
+void JsonTranscoder::writeDocumentEnd()
+{
+    m_out.put('\n');
+}
+
+ParseError JsonTranscoder::outputError() const
+{
+    return m_out.failed() ? ParseError::WriteFailed : ParseError::None;
+}
+
+// Runs without escapes are found a vector at a time and copied whole
+void JsonTranscoder::putString(std::string_view text)
+{
+    static const CleanPrefixFunction clean_prefix = selectKernel();
+
+    const unsigned char* p = (const unsigned char*)text.data();
+    size_t length = text.size();
+
+    m_out.put('"');
+    while (true) {
+        size_t clean = clean_prefix(p, length);
+        m_out.put(std::string_view((const char*)p, clean));
+        if (clean == length)
+            break;
+
+        unsigned char c = p[clean];
+        p += clean + 1;
+        length -= clean + 1;
+
+        switch (c)
+        {
+        case '"':
+            m_out.put("\\\"");
+            break;
+        case '\\':
+            m_out.put("\\\\");
+            break;
+        case '\n':
+            m_out.put("\\n");
+            break;
+        case '\r':
+            m_out.put("\\r");
+            break;
+        case '\t':
+            m_out.put("\\t");
+            break;
+        case '\b':
+            m_out.put("\\b");
+            break;
+        case '\f':
+            m_out.put("\\f");
+            break;
+        default: {
+            static const char HEX[] = "0123456789abcdef";
+            char escape[6] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+            m_out.put(std::string_view(escape, sizeof(escape)));
+            break;
+        }
+        }
+    }
+    m_out.put('"');
+}
+
+} // namespace EmbedYAML
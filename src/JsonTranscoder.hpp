@@ -0,0 +1,29 @@
+#pragma once
+
+#include "EmbedYAML/BlockWriter.hpp"
+#include "Transcoder.hpp"
+
+namespace EmbedYAML {
+
+// Writes parser events out as compact JSON, one line per document. Keys are always strings,
+// .inf and .nan are written as strings since JSON has no number for them.
+class JsonTranscoder : public Transcoder {
+public:
+    JsonTranscoder(BlockWriter& out, const ParseLimits& limits) : Transcoder(limits), m_out(out) {}
+
+protected:
+    void writeKey(std::string_view text) override;
+    void writeScalar(std::string_view text, bool quoted) override;
+    void writeStart(bool is_mapping) override;
+    void writeEnd(bool is_mapping, size_t count) override;
+    void writeSeparator() override;
+    void writeDocumentEnd() override;
+    ParseError outputError() const override;
+
+private:
+    void putString(std::string_view text);
+
+    BlockWriter& m_out;
+};
+
+} // namespace EmbedYAML
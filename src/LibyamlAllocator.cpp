@@ -0,0 +1,128 @@
+#include "LibyamlAllocator.hpp"
+#include <atomic>
+#include <cstring>
+#include <new>
+
+// Built into libyaml, whose malloc, realloc, free and strdup calls are renamed to the hooks
+// below. Each block records its size and allocator in front of the payload, so realloc
+// knows what to copy and blocks are returned where they came from after a switch.
+
+namespace EmbedYAML {
+
+namespace {
+
+struct BlockHeader {
+    size_t size;
+    YAMLAllocator* allocator;
+};
+
+constexpr size_t HEADER = (sizeof(BlockHeader) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+std::atomic<YAMLAllocator*> g_allocator{nullptr};
+thread_local AllocationStats* t_stats = nullptr;
+
+BlockHeader* headerOf(void* ptr)
+{
+    return (BlockHeader*)((unsigned char*)ptr - HEADER);
+}
+
+void* allocateBlock(size_t size)
+{
+    YAMLAllocator* allocator = g_allocator.load(std::memory_order_acquire);
+    void* block = allocator ? allocator->allocate(size + HEADER) : ::operator new(size + HEADER, std::nothrow);
+    if (!block)
+        return nullptr;
+
+    *(BlockHeader*)block = BlockHeader{size, allocator};
+
+    if (AllocationStats* stats = t_stats) {
+        stats->allocations++;
+        stats->bytes += size;
+        stats->live_bytes += size;
+        if (stats->live_bytes > stats->peak_bytes)
+            stats->peak_bytes = stats->live_bytes;
+    }
+
+    return (unsigned char*)block + HEADER;
+}
+
+void freeBlock(void* ptr)
+{
+    BlockHeader* header = headerOf(ptr);
+
+    // Blocks freed under another scope, such as an event outliving its parser, may not be on the books
+    if (AllocationStats* stats = t_stats) {
+        stats->deallocations++;
+        stats->live_bytes -= header->size <= stats->live_bytes ? header->size : stats->live_bytes;
+    }
+
+    if (header->allocator)
+        header->allocator->deallocate(header, header->size + HEADER);
+    else
+        ::operator delete(header);
+}
+
+} // namespace
+
+void setYAMLAllocator(YAMLAllocator* allocator)
+{
+    g_allocator.store(allocator, std::memory_order_release);
+}
+
+YAMLAllocator* getYAMLAllocator()
+{
+    return g_allocator.load(std::memory_order_acquire);
+}
+
+AllocationScope::AllocationScope(AllocationStats* stats)
+    : m_previous(t_stats)
+{
+    if (stats)
+        t_stats = stats;
+}
+
+AllocationScope::~AllocationScope()
+{
+    t_stats = m_previous;
+}
+
+} // namespace EmbedYAML
+
+extern "C" void* embedyaml_yaml_malloc(size_t size)
+{
+    return EmbedYAML::allocateBlock(size);
+}
+
+extern "C" void embedyaml_yaml_free(void* ptr)
+{
+    if (ptr)
+        EmbedYAML::freeBlock(ptr);
+}
+
+// Shrinking keeps the block, growing always moves it since allocators offer no resize
+extern "C" void* embedyaml_yaml_realloc(void* ptr, size_t size)
+{
+    if (!ptr)
+        return embedyaml_yaml_malloc(size);
+
+    size_t old_size = EmbedYAML::headerOf(ptr)->size;
+    if (size <= old_size)
+        return ptr;
+
+    void* grown = embedyaml_yaml_malloc(size);
+    if (!grown)
+        return nullptr;
+
+    std::memcpy(grown, ptr, old_size);
+    embedyaml_yaml_free(ptr);
+    return grown;
+}
+
+extern "C" char* embedyaml_yaml_strdup(const char* str)
+{
+    size_t length = std::strlen(str) + 1;
+    char* copy = (char*)embedyaml_yaml_malloc(length);
+    if (copy)
+        std::memcpy(copy, str, length);
+    return copy;
+}
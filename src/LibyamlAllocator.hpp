@@ -0,0 +1,20 @@
+#pragma once
+
+#include "EmbedYAML/YAMLAllocator.hpp"
+
+namespace EmbedYAML {
+
+// Charges the libyaml allocations made on this thread to stats until destroyed
+class AllocationScope {
+public:
+    explicit AllocationScope(AllocationStats* stats);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    AllocationStats* m_previous;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,548 @@
+#include "NativeScanner.hpp"
+#include "StructuralIndex.hpp"
+#include "Utf8.hpp"
+#include "YAMLTreeBuilder.hpp"
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace EmbedYAML {
+
+namespace {
+
+bool isBlank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// Block sequence entry indicator
+bool isDash(const char* p, const char* end)
+{
+    return *p == '-' && (p + 1 == end || isBlank(p[1]));
+}
+
+bool isMarker(const char* line, const char* end, char c)
+{
+    return end - line >= 3 && line[0] == c && line[1] == c && line[2] == c
+        && (end - line == 3 || isBlank(line[3]));
+}
+
+const char* skipBlanks(const char* p, const char* end)
+{
+    while (p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+// NEL and the Unicode line and paragraph separators, further line breaks to libyaml
+bool hasUnicodeBreak(const char* p, const char* end)
+{
+    for (const char* c = p; (c = (const char*)std::memchr(c, '\xC2', end - c)); ++c) {
+        if (c + 1 < end && c[1] == '\x85')
+            return true;
+    }
+    for (const char* c = p; (c = (const char*)std::memchr(c, '\xE2', end - c)); ++c) {
+        if (c + 2 < end && c[1] == '\x80' && (c[2] == '\xA8' || c[2] == '\xA9'))
+            return true;
+    }
+    return false;
+}
+
+class NativeScanner {
+public:
+    explicit NativeScanner(YAMLTreeBuilder& builder) : m_builder(builder) {}
+
+    NativeResult run(const char* data, size_t length, bool validated);
+
+private:
+    struct Container {
+        size_t indent;
+        bool mapping;
+    };
+
+    bool nextLine(const char* p, const char*& line_end, const char*& next);
+    bool line(const char* p, const char* end, size_t indent);
+    bool node(const char* p, const char* end, size_t column, bool fresh, bool after_dash);
+    const char* scalar(const char* p, const char* end, std::string& value);
+    const char* doubleQuoted(const char* p, const char* end, std::string& value);
+    const char* singleQuoted(const char* p, const char* end, std::string& value);
+    bool blockScalar(const char* p, const char* end, std::string& value);
+
+    void open(size_t indent, bool mapping);
+    void close();
+    void emit(std::string value);
+
+    YAMLTreeBuilder& m_builder;
+    StructuralCursor* m_cursor = nullptr;
+    const char* m_end = nullptr;
+    const char* m_next = nullptr;   // Start of the line after the current one, block scalars move it on
+    std::vector<Container> m_stack;
+    bool m_pending = false;     // A key or entry indicator still waits for its value
+    bool m_started = false;
+    bool m_complete = false;
+};
+
+NativeResult NativeScanner::run(const char* data, size_t length, bool validated)
+{
+    const char* end = data + length;
+    const char* p = data;
+
+    // Leave other encodings and anything libyaml would reject to libyaml
+    if (!validated) {
+        if (length >= 3 && std::memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+            p += 3;
+        if (!validateInput(p, end - p))
+            return NativeResult::Unsupported;
+    }
+    if (hasUnicodeBreak(p, end))
+        return NativeResult::Unsupported;
+
+    // Line breaks, indicators and quotes are located up front in bulk
+    StructuralIndex index;
+    if (!index.build(p, end - p))
+        return NativeResult::Unsupported;
+
+    StructuralCursor cursor(p, index);
+    m_cursor = &cursor;
+    m_end = end;
+
+    bool document_start = false;
+
+    while (p < end) {
+        const char* line_end;
+        const char* next;
+        if (!nextLine(p, line_end, next))
+            return NativeResult::Unsupported;
+
+        const char* content = p;
+        while (content < line_end && *content == ' ')
+            content++;
+
+        if (content == line_end || *content == '#') {
+            p = next;
+            continue;
+        }
+
+        if (*content == '\t')
+            return NativeResult::Unsupported;
+
+        if (content == p) {
+            if (*p == '%')
+                return NativeResult::Unsupported;
+
+            // Only the first document is built, its end marks the end of input
+            if (isMarker(p, line_end, '-') || isMarker(p, line_end, '.')) {
+                if (m_started)
+                    break;
+                if (document_start || *p == '.')
+                    return NativeResult::Unsupported;
+
+                const char* rest = skipBlanks(p + 3, line_end);
+                if (rest != line_end && *rest != '#')
+                    return NativeResult::Unsupported;
+
+                document_start = true;
+                p = next;
+                continue;
+            }
+        }
+
+        m_next = next;
+        if (!line(content, line_end, content - p))
+            return NativeResult::Unsupported;
+        if (m_builder.error() != ParseError::None)
+            return NativeResult::Rejected;
+
+        p = m_next;
+    }
+
+    if (!m_started)
+        return NativeResult::Empty;
+
+    if (m_pending) {
+        m_pending = false;
+        emit(std::string());
+    }
+    while (!m_stack.empty())
+        close();
+
+    if (m_builder.error() != ParseError::None)
+        return NativeResult::Rejected;
+
+    return m_complete ? NativeResult::Complete : NativeResult::Unsupported;
+}
+
+// Finds the end of the line starting at p and the start of the one after it,
+// false on a lone carriage return which libyaml also treats as a line break
+bool NativeScanner::nextLine(const char* p, const char*& line_end, const char*& next)
+{
+    line_end = m_cursor->find(p, m_end, "\n\r");
+    next = line_end;
+
+    if (line_end < m_end) {
+        if (*line_end == '\n')
+            next = line_end + 1;
+        else if (line_end + 1 < m_end && line_end[1] == '\n')
+            next = line_end + 2;
+        else
+            return false;
+    }
+
+    return true;
+}
+
+bool NativeScanner::line(const char* p, const char* end, size_t indent)
+{
+    if (m_pending) {
+        const Container& top = m_stack.back();
+
+        // Nested block, or a sequence sharing the indentation of its mapping key
+        if (indent > top.indent || (indent == top.indent && top.mapping && isDash(p, end))) {
+            m_pending = false;
+            return node(p, end, indent, true, false);
+        }
+
+        m_pending = false;
+        emit(std::string());
+    }
+
+    while (!m_stack.empty() && m_stack.back().indent > indent)
+        close();
+
+    if (m_stack.empty()) {
+        if (m_started)
+            return false;
+        return node(p, end, indent, true, false);
+    }
+
+    // Deeper lines here would be multi-line scalars
+    if (m_stack.back().indent != indent)
+        return false;
+
+    if (!m_stack.back().mapping && !isDash(p, end)) {
+        if (m_stack.size() < 2 || !m_stack[m_stack.size() - 2].mapping || m_stack[m_stack.size() - 2].indent != indent)
+            return false;
+        close();
+    }
+
+    return node(p, end, indent, false, false);
+}
+
+// Parses the node content of a line from p, which sits at the given column. A fresh
+// node opens a new collection, otherwise the line continues the innermost one.
+bool NativeScanner::node(const char* p, const char* end, size_t column, bool fresh, bool after_dash)
+{
+    for (;;) {
+        if (isDash(p, end)) {
+            if (fresh)
+                open(column, false);
+            else if (m_stack.back().mapping)
+                return false;
+
+            // libyaml rejects a tab anywhere between the dash and its item
+            const char* item = p + 1;
+            while (item < end && *item == ' ')
+                ++item;
+            if (item < end && *item == '\t')
+                return false;
+            if (item == end || *item == '#') {
+                m_pending = true;
+                return true;
+            }
+
+            column += item - p;
+            p = item;
+            fresh = true;
+            after_dash = true;
+            continue;
+        }
+
+        std::string value;
+        if (after_dash && (*p == '|' || *p == '>')) {
+            if (!blockScalar(p, end, value))
+                return false;
+            emit(std::move(value));
+            return true;
+        }
+
+        const char* q = scalar(p, end, value);
+        if (!q)
+            return false;
+        q = skipBlanks(q, end);
+
+        if (q < end && *q == ':' && (q + 1 == end || q[1] == ' ')) {
+            if (fresh)
+                open(column, true);
+            else if (!m_stack.back().mapping)
+                return false;
+            emit(std::move(value));
+
+            const char* v = skipBlanks(q + 1, end);
+            if (v == end || *v == '#') {
+                m_pending = true;
+                return true;
+            }
+
+            if (*v == '|' || *v == '>') {
+                if (!blockScalar(v, end, value))
+                    return false;
+                emit(std::move(value));
+                return true;
+            }
+
+            if (isDash(v, end) || !(q = scalar(v, end, value)))
+                return false;
+            q = skipBlanks(q, end);
+            if (q != end && *q != '#')
+                return false;
+
+            emit(std::move(value));
+            return true;
+        }
+
+        // A lone scalar is only complete when it follows an entry indicator
+        if (!after_dash || (q != end && *q != '#'))
+            return false;
+
+        emit(std::move(value));
+        return true;
+    }
+}
+
+// Reads one scalar, returning where it ends or null when it is outside the subset
+const char* NativeScanner::scalar(const char* p, const char* end, std::string& value)
+{
+    if (*p == '"')
+        return doubleQuoted(p, end, value);
+    if (*p == '\'')
+        return singleQuoted(p, end, value);
+
+    // Flow collections, anchors, aliases, tags, misplaced block scalars and reserved indicators
+    if (std::strchr("[]{},#&*!|>%@`?:", *p))
+        return nullptr;
+
+    // The index only holds ':' followed by a blank and '#' preceded by one
+    const char* q = m_cursor->find(p, end, ":#");
+
+    const char* last = q;
+    while (last > p && isBlank(last[-1]))
+        last--;
+
+    value.assign(p, last);
+    return q;
+}
+
+// Runs between escapes are copied whole, the index locates each '\\' and the closing quote
+const char* NativeScanner::doubleQuoted(const char* p, const char* end, std::string& value)
+{
+    value.clear();
+
+    for (++p; p < end; ) {
+        const char* q = m_cursor->find(p, end, "\"\\");
+        if (q == end)
+            break;
+
+        value.append(p, q);
+        if (*q == '"')
+            return q + 1;
+
+        p = q + 1;
+        if (p == end)
+            return nullptr;
+
+        size_t digits = 0;
+        switch (*p)
+        {
+        case '0': value += '\0'; break;
+        case 'a': value += '\a'; break;
+        case 'b': value += '\b'; break;
+        case 't': case '\t': value += '\t'; break;
+        case 'n': value += '\n'; break;
+        case 'v': value += '\v'; break;
+        case 'f': value += '\f'; break;
+        case 'r': value += '\r'; break;
+        case 'e': value += '\x1B'; break;
+        case ' ': value += ' '; break;
+        case '"': value += '"'; break;
+        case '/': value += '/'; break;
+        case '\\': value += '\\'; break;
+        case 'N': appendUtf8(value, 0x85); break;
+        case '_': appendUtf8(value, 0xA0); break;
+        case 'L': appendUtf8(value, 0x2028); break;
+        case 'P': appendUtf8(value, 0x2029); break;
+        case 'x': digits = 2; break;
+        case 'u': digits = 4; break;
+        case 'U': digits = 8; break;
+        default:
+            return nullptr;
+        }
+
+        if (digits) {
+            if ((size_t)(end - p) <= digits)
+                return nullptr;
+
+            uint32_t code = 0;
+            for (size_t i = 1; i <= digits; ++i) {
+                char h = p[i];
+                int nibble = (h >= '0' && h <= '9') ? h - '0'
+                           : (h >= 'a' && h <= 'f') ? h - 'a' + 10
+                           : (h >= 'A' && h <= 'F') ? h - 'A' + 10 : -1;
+                if (nibble < 0)
+                    return nullptr;
+                code = (code << 4) | nibble;
+            }
+
+            if ((code >= 0xD800 && code <= 0xDFFF) || code > 0x10FFFF)
+                return nullptr;
+
+            appendUtf8(value, code);
+            p += digits;
+        }
+
+        p++;
+    }
+
+    // Multi-line quoted scalars are left to libyaml
+    return nullptr;
+}
+
+const char* NativeScanner::singleQuoted(const char* p, const char* end, std::string& value)
+{
+    value.clear();
+
+    for (++p; p < end; ) {
+        const char* quote = m_cursor->find(p, end, "'");
+        if (quote == end)
+            return nullptr;
+
+        value.append(p, quote);
+        if (quote + 1 < end && quote[1] == '\'') {
+            value += '\'';
+            p = quote + 2;
+            continue;
+        }
+        return quote + 1;
+    }
+
+    return nullptr;
+}
+
+// Reads a literal or folded block scalar whose header starts at p, consuming its content
+// lines from m_next. Mirrors libyaml's indentation detection, folding and chomping.
+bool NativeScanner::blockScalar(const char* p, const char* end, std::string& value)
+{
+    bool literal = *p == '|';
+    int chomping = 0;
+    size_t increment = 0;
+
+    for (++p; p < end && !isBlank(*p); ++p) {
+        if ((*p == '+' || *p == '-') && !chomping)
+            chomping = *p == '+' ? 1 : -1;
+        else if (*p >= '1' && *p <= '9' && !increment)
+            increment = *p - '0';
+        else
+            return false;
+    }
+
+    p = skipBlanks(p, end);
+    if (p != end && *p != '#')
+        return false;
+
+    // Every break inside the scalar reads as '\n', so only counts are kept
+    size_t parent = m_stack.back().indent;
+    size_t indent = increment ? parent + increment : 0;
+    size_t trailing_breaks = 0;
+    bool leading_break = false;
+    bool leading_blank = false;
+
+    value.clear();
+
+    for (;;) {
+        // Leading empty lines, the first content line settles an undetected indentation
+        const char* line_end = m_next;
+        const char* next = m_next;
+        const char* content = m_next;
+        size_t max_indent = 0;
+
+        while (m_next < m_end) {
+            if (!nextLine(m_next, line_end, next))
+                return false;
+
+            content = m_next;
+            while (content < line_end && *content == ' ' && (!indent || (size_t)(content - m_next) < indent))
+                content++;
+
+            size_t column = content - m_next;
+            if (column > max_indent)
+                max_indent = column;
+            if (content < line_end && *content == '\t' && (!indent || column < indent))
+                return false;
+            if (content < line_end || next == line_end)
+                break;
+
+            trailing_breaks++;
+            m_next = next;
+        }
+
+        if (!indent)
+            indent = max_indent > parent ? max_indent : parent + 1;
+
+        if (m_next == m_end || (size_t)(content - m_next) != indent || content == line_end)
+            break;
+
+        bool trailing_blank = isBlank(*content);
+        if (!literal && leading_break && !leading_blank && !trailing_blank) {
+            if (!trailing_breaks)
+                value += ' ';
+        } else if (leading_break) {
+            value += '\n';
+        }
+
+        value.append(trailing_breaks, '\n');
+        trailing_breaks = 0;
+        leading_blank = trailing_blank;
+
+        value.append(content, line_end);
+        leading_break = next != line_end;
+        m_next = next;
+    }
+
+    if (chomping != -1 && leading_break)
+        value += '\n';
+    if (chomping == 1)
+        value.append(trailing_breaks, '\n');
+
+    return true;
+}
+
+void NativeScanner::open(size_t indent, bool mapping)
+{
+    m_started = true;
+    m_stack.push_back(Container{indent, mapping});
+
+    if (mapping)
+        m_builder.mappingStart();
+    else
+        m_builder.sequenceStart();
+}
+
+void NativeScanner::close()
+{
+    m_stack.pop_back();
+    m_complete = m_builder.collectionEnd();
+}
+
+void NativeScanner::emit(std::string value)
+{
+    m_builder.scalar(std::move(value));
+}
+
+} // namespace
+
+NativeResult parseNative(const char* data, size_t length, YAMLTreeBuilder& builder, bool validated)
+{
+    return NativeScanner(builder).run(data, length, validated);
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <EmbedYAML/YAMLNode.hpp>
+#include <cstddef>
+
+namespace EmbedYAML {
+
+class YAMLTreeBuilder;
+
+enum class NativeResult {
+    Complete,       // The first document was built
+    Empty,          // The input holds no document
+    Rejected,       // A parse limit was exceeded, the builder holds the partial tree
+    Unsupported     // Syntax outside the native subset, parse with libyaml instead
+};
+
+// Builds the first document straight from the buffer without libyaml, for the
+// common subset of block mappings, block sequences, single-line plain and quoted
+// scalars, literal and folded block scalars and comments. Validated input has
+// already been through prepareInput(). The tree is left in the builder, which has
+// to be reset before reuse after Unsupported.
+NativeResult parseNative(const char* data, size_t length, YAMLTreeBuilder& builder, bool validated = false);
+
+} // namespace EmbedYAML
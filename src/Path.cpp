@@ -0,0 +1,160 @@
+#include "EmbedYAML/Path.hpp"
+
+namespace EmbedYAML {
+
+namespace {
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+// Position of child among the children of parent, which holds when it was not merged in
+size_t positionOf(const YAMLNode& parent, const YAMLNode* child)
+{
+    const YAMLNode* first = parent.find((size_t)0);
+    if (!first || child < first || child >= first + parent.size())
+        return SIZE_MAX;
+    return (size_t)(child - first);
+}
+
+} // namespace
+
+Path::Path(std::string_view expression)
+{
+    size_t i = 0;
+    bool expect_key = !expression.empty() && expression[0] != '[';
+
+    while (i < expression.size()) {
+        if (expect_key) {
+            size_t start = i;
+            while (i < expression.size() && expression[i] != '.' && expression[i] != '[' && expression[i] != ']')
+                i++;
+            if (i == start)
+                return;
+
+            Step step;
+            step.key = std::string(expression.substr(start, i - start));
+            step.hash = keyHash(step.key);
+            m_steps.push_back(std::move(step));
+            expect_key = false;
+            continue;
+        }
+
+        if (expression[i] == '.') {
+            i++;
+            expect_key = true;
+            if (i == expression.size())
+                return;
+            continue;
+        }
+
+        if (expression[i] != '[')
+            return;
+
+        size_t start = ++i;
+        size_t index = 0;
+        while (i < expression.size() && isDigit(expression[i])) {
+            if (index > (SIZE_MAX - 9) / 10)
+                return;
+            index = index * 10 + (size_t)(expression[i++] - '0');
+        }
+        if (i == start || i == expression.size() || expression[i] != ']')
+            return;
+        i++;
+
+        Step step;
+        step.index = index;
+        step.is_index = true;
+        m_steps.push_back(std::move(step));
+    }
+
+    m_valid = true;
+}
+
+const YAMLNode* Path::find(const YAMLNode& root) const
+{
+    if (!m_valid)
+        return nullptr;
+
+    const YAMLNode* node = &root;
+    for (const auto& step : m_steps) {
+        node = step.is_index ? node->find(step.index) : node->findHashed(step.hash, step.key);
+        if (!node)
+            return nullptr;
+    }
+    return node;
+}
+
+NodeRef Path::find(NodeRef root) const
+{
+    if (!m_valid)
+        return NodeRef();
+
+    NodeRef node = root;
+    for (const auto& step : m_steps) {
+        node = step.is_index ? node[step.index] : node.find(step.key);
+        if (!node)
+            return NodeRef();
+    }
+    return node;
+}
+
+Query::Query(Path path)
+    : m_path(std::move(path)),
+      m_positions(m_path.steps().size(), UNRESOLVED)
+{
+}
+
+const YAMLNode* Query::resolve(const YAMLNode& root)
+{
+    if (!m_path.valid())
+        return nullptr;
+
+    const YAMLNode* node = &root;
+    const auto& steps = m_path.steps();
+
+    for (size_t i = 0; i < steps.size() && node; ++i) {
+        const Path::Step& step = steps[i];
+        if (step.is_index) {
+            node = node->find(step.index);
+            continue;
+        }
+
+        // The remembered child still carries the key, compared by hash before text
+        const YAMLNode* child = m_positions[i] != UNRESOLVED ? node->find(m_positions[i]) : nullptr;
+        if (child && node->isMapping() && child->getKeyHash() == step.hash && child->getKey() == step.key) {
+            node = child;
+            continue;
+        }
+
+        child = node->findHashed(step.hash, step.key);
+        if (child)
+            m_positions[i] = positionOf(node->resolved(), child);
+        node = child;
+    }
+
+    m_root = &root;
+    m_result = node;
+    m_cached = false;
+    return node;
+}
+
+const YAMLNode* Query::resolve(const YAMLNode& root, uint64_t generation)
+{
+    if (m_cached && m_root == &root && m_generation == generation)
+        return m_result;
+
+    const YAMLNode* result = resolve(root);
+    m_generation = generation;
+    m_cached = true;
+    return result;
+}
+
+void Query::invalidate()
+{
+    m_cached = false;
+    m_positions.assign(m_positions.size(), UNRESOLVED);
+}
+
+} // namespace EmbedYAML
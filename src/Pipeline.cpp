@@ -0,0 +1,142 @@
+#include "Pipeline.hpp"
+#include "SPSCRing.hpp"
+#include "YAMLTreeBuilder.hpp"
+#include <new>
+
+namespace EmbedYAML {
+
+namespace {
+
+// Compact copy of a libyaml event that owns its scalar text and anchor name
+struct PipelineEvent {
+    yaml_event_type_t type = YAML_NO_EVENT;
+    std::string value;
+    std::string anchor;
+};
+
+void copyAnchor(std::string& out, const yaml_char_t* anchor)
+{
+    if (anchor)
+        out.assign((const char*)anchor);
+    else
+        out.clear();
+}
+
+// Copies events from libyaml into the ring until the stream ends, fails or the consumer stops
+void producerLoop(YAMLEventReader& reader, SPSCRing<PipelineEvent>& ring, std::atomic<bool>& stop, PipelineEvent& record)
+{
+    for (;;) {
+        // A parser error closes the pipeline with YAML_NO_EVENT
+        if (!reader.next()) {
+            record.type = YAML_NO_EVENT;
+            ring.push(record, stop);
+            return;
+        }
+
+        const yaml_event_t& event = reader.event();
+        record.type = event.type;
+        switch (event.type)
+        {
+        case YAML_SCALAR_EVENT:
+            record.value.assign((char*)event.data.scalar.value, event.data.scalar.length);
+            copyAnchor(record.anchor, event.data.scalar.anchor);
+            break;
+        case YAML_ALIAS_EVENT:
+            copyAnchor(record.anchor, event.data.alias.anchor);
+            break;
+        case YAML_MAPPING_START_EVENT:
+            copyAnchor(record.anchor, event.data.mapping_start.anchor);
+            break;
+        case YAML_SEQUENCE_START_EVENT:
+            copyAnchor(record.anchor, event.data.sequence_start.anchor);
+            break;
+        default:
+            break;
+        }
+
+        if (!ring.push(record, stop) || record.type == YAML_STREAM_END_EVENT)
+            return;
+    }
+}
+
+} // namespace
+
+bool buildRootPipelined(YAMLEventReader& reader, YAMLTreeBuilder& builder, YAMLNode& root, size_t capacity)
+{
+    SPSCRing<PipelineEvent> ring(capacity);
+    std::atomic<bool> stop{false};
+    bool out_of_memory = false;
+
+    std::thread producer([&] {
+        PipelineEvent record;
+        EMBEDYAML_TRY {
+            producerLoop(reader, ring, stop, record);
+        } EMBEDYAML_CATCH(const std::bad_alloc&) {
+            // Closes the pipeline like a parser error, reported once the producer is joined
+            out_of_memory = true;
+            record = PipelineEvent();
+            ring.push(record, stop);
+        }
+    });
+
+    PipelineEvent record;
+    bool started = false;
+    bool complete = false;
+
+    EMBEDYAML_TRY {
+        while (!complete) {
+            ring.pop(record);
+            if (record.type == YAML_NO_EVENT || record.type == YAML_STREAM_END_EVENT)
+                break;
+
+            switch (record.type)
+            {
+            case YAML_SCALAR_EVENT:
+                complete = builder.scalar(std::move(record.value), std::move(record.anchor));
+                break;
+            case YAML_ALIAS_EVENT:
+                complete = builder.alias(record.anchor);
+                break;
+            case YAML_MAPPING_START_EVENT:
+                complete = builder.mappingStart(std::move(record.anchor));
+                break;
+            case YAML_SEQUENCE_START_EVENT:
+                complete = builder.sequenceStart(std::move(record.anchor));
+                break;
+            case YAML_MAPPING_END_EVENT:
+            case YAML_SEQUENCE_END_EVENT:
+                complete = builder.collectionEnd();
+                break;
+            default:
+                continue;
+            }
+            started = true;
+        }
+    } EMBEDYAML_CATCH(...) {
+        stop = true;
+        producer.join();
+        EMBEDYAML_RETHROW;
+    }
+
+    // Only the first document is wanted, release the producer if it is still scanning
+    stop = true;
+    producer.join();
+
+    // A limit also ends the build early, the reader is only consulted once the producer is done
+    if (out_of_memory) {
+        builder.fail(ParseError::OutOfMemory);
+        complete = false;
+    } else if (!complete) {
+        builder.fail(reader.error());
+    } else if (builder.error() != ParseError::None) {
+        complete = false;
+    }
+
+    if (!started)
+        return false;
+
+    root = std::move(builder.result());
+    return complete;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "EmbedYAML/YAMLStream.hpp"
+
+namespace EmbedYAML {
+
+class YAMLTreeBuilder;
+
+// Builds the root of the first document with libyaml running on a second thread,
+// handing events to the tree builder through a ring of the given capacity. Root is
+// left untouched unless a document was started.
+bool buildRootPipelined(YAMLEventReader& reader, YAMLTreeBuilder& builder, YAMLNode& root, size_t capacity);
+
+} // namespace EmbedYAML
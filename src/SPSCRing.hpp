@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Lock-free bounded queue for exactly one producer thread and one consumer thread
+template <typename T>
+class SPSCRing {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SPSCRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    bool tryPush(T& value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head > m_mask) {
+            m_cached_head = m_head.load(std::memory_order_acquire);
+            if (tail - m_cached_head > m_mask)
+                return false;
+        }
+
+        m_slots[tail & m_mask] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail) {
+            m_cached_tail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cached_tail)
+                return false;
+        }
+
+        value = std::move(m_slots[head & m_mask]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Spins until the value is queued, giving up once abort is set
+    bool push(T& value, const std::atomic<bool>& abort) {
+        while (!tryPush(value)) {
+            if (abort.load(std::memory_order_relaxed))
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void pop(T& value) {
+        while (!tryPop(value))
+            std::this_thread::yield();
+    }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask;
+
+    // Each index lives on its own cache line next to the copy of the other
+    // index that its owning thread last observed
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_cached_tail = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_cached_head = 0;
+};
+
+} // namespace EmbedYAML
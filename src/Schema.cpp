@@ -0,0 +1,468 @@
+#include "EmbedYAML/Schema.hpp"
+#include "EmbedYAML/KeyHash.hpp"
+#include "EmbedYAML/YAMLResult.hpp"
+#include "SchemaWalker.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <unordered_set>
+
+namespace EmbedYAML {
+
+namespace {
+
+struct TypeName {
+    std::string_view name;
+    uint8_t bits;
+};
+
+// Integers are numbers too, so number accepts both
+constexpr TypeName TYPE_NAMES[] = {
+    {"any", 127},
+    {"null", 1},
+    {"bool", 2},
+    {"integer", 4},
+    {"number", 12},
+    {"string", 16},
+    {"mapping", 32},
+    {"sequence", 64},
+};
+
+bool addType(std::string_view name, uint8_t& types)
+{
+    for (const auto& type : TYPE_NAMES) {
+        if (type.name == name) {
+            types |= type.bits;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string keyPath(const std::string& path, const std::string& key)
+{
+    return path.empty() ? key : path + "." + key;
+}
+
+std::string indexPath(const std::string& path, size_t index)
+{
+    return path + "[" + std::to_string(index) + "]";
+}
+
+bool isNull(std::string_view text)
+{
+    return text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL";
+}
+
+// Integers first, since hex and octal forms are not floats
+bool numberOf(std::string_view text, double& value)
+{
+    if (YAMLResult<int64_t> integer = YAMLResult<int64_t>::parse(text)) {
+        value = (double)integer.value();
+        return true;
+    }
+    if (YAMLResult<uint64_t> integer = YAMLResult<uint64_t>::parse(text)) {
+        value = (double)integer.value();
+        return true;
+    }
+    if (YAMLResult<double> number = YAMLResult<double>::parse(text)) {
+        value = number.value();
+        return true;
+    }
+    return false;
+}
+
+// Splitting stops at this depth or once there are this many subtrees per thread
+constexpr unsigned MAX_SPLIT_LEVELS = 8;
+constexpr size_t UNITS_PER_THREAD = 16;
+
+} // namespace
+
+Schema::Schema(const YAMLNode& definition)
+{
+    m_rules.emplace_back();
+    m_root = compile(definition, std::string());
+    m_valid = m_root != NO_RULE;
+
+    // Accepts no type at all, so every document is rejected
+    if (!m_valid) {
+        m_rules.assign(1, Rule());
+        m_properties.clear();
+        m_enums.clear();
+        m_rules.emplace_back().types = 0;
+        m_root = 1;
+    }
+}
+
+uint32_t Schema::fail(const std::string& path)
+{
+    m_error_path = path;
+    return NO_RULE;
+}
+
+// Children are compiled before their parent is stored, so the properties of every rule
+// are gathered first and appended in one block
+uint32_t Schema::compile(const YAMLNode& definition, const std::string& path)
+{
+    const YAMLNode& node = definition.resolved();
+    if (!node.isMapping())
+        return fail(path);
+
+    Rule rule;
+    std::vector<Property> properties;
+    const YAMLNode* required = nullptr;
+    bool typed = false;
+
+    for (size_t i = 0; i < node.size(); ++i) {
+        const std::string& keyword = node[i].getKey();
+        const YAMLNode& value = node[i].resolved();
+        std::string at = keyPath(path, keyword);
+
+        if (keyword == "type") {
+            rule.types = 0;
+            typed = true;
+            if (value.isScalar()) {
+                if (!addType(value.asScalar(), rule.types))
+                    return fail(at);
+            } else if (value.isSequence() && value.size() > 0) {
+                for (size_t j = 0; j < value.size(); ++j) {
+                    if (!value[j].isScalar() || !addType(value[j].asScalar(), rule.types))
+                        return fail(indexPath(at, j));
+                }
+            } else {
+                return fail(at);
+            }
+        } else if (keyword == "properties") {
+            if (!value.isMapping())
+                return fail(at);
+            for (size_t j = 0; j < value.size(); ++j) {
+                const std::string& key = value[j].getKey();
+                uint32_t child = compile(value[j], keyPath(at, key));
+                if (child == NO_RULE)
+                    return NO_RULE;
+                properties.push_back(Property{keyHash(key), key, child, NOT_REQUIRED});
+            }
+        } else if (keyword == "required") {
+            if (!value.isSequence())
+                return fail(at);
+            required = &value;
+        } else if (keyword == "additional_properties") {
+            YAMLResult<bool> allowed = value.tryAs<bool>();
+            if (allowed) {
+                rule.additional = allowed.value() ? ANY_RULE : NO_RULE;
+            } else {
+                rule.additional = compile(value, at);
+                if (rule.additional == NO_RULE)
+                    return NO_RULE;
+            }
+        } else if (keyword == "items") {
+            rule.items = compile(value, at);
+            if (rule.items == NO_RULE)
+                return NO_RULE;
+        } else if (keyword == "minimum" || keyword == "maximum") {
+            YAMLResult<double> number = value.tryAs<double>();
+            if (!number)
+                return fail(at);
+            (keyword == "minimum" ? rule.minimum : rule.maximum) = number.value();
+        } else if (keyword == "min_size" || keyword == "max_size") {
+            YAMLResult<size_t> size = value.tryAs<size_t>();
+            if (!size)
+                return fail(at);
+            (keyword == "min_size" ? rule.min_size : rule.max_size) = size.value();
+        } else if (keyword == "enum") {
+            if (!value.isSequence())
+                return fail(at);
+            rule.first_enum = (uint32_t)m_enums.size();
+            rule.enum_count = (uint32_t)value.size();
+            for (size_t j = 0; j < value.size(); ++j) {
+                if (!value[j].isScalar())
+                    return fail(indexPath(at, j));
+                m_enums.push_back(value[j].asScalar());
+            }
+        } else {
+            return fail(at);
+        }
+    }
+
+    // An enum lists scalars, so without a type it rules out collections
+    if (rule.enum_count > 0 && !typed)
+        rule.types = SCALAR_TYPES;
+
+    // Required keys get a bit each, those without a rule of their own accept anything
+    if (required) {
+        std::string at = keyPath(path, "required");
+        for (size_t j = 0; j < required->size(); ++j) {
+            if (!(*required)[j].isScalar())
+                return fail(indexPath(at, j));
+
+            std::string key = (*required)[j].asScalar();
+            auto it = std::find_if(properties.begin(), properties.end(),
+                                   [&](const Property& property) { return property.key == key; });
+            if (it == properties.end()) {
+                properties.push_back(Property{keyHash(key), key, ANY_RULE, NOT_REQUIRED});
+                it = properties.end() - 1;
+            }
+            if (it->required == NOT_REQUIRED)
+                it->required = rule.required_count++;
+        }
+    }
+
+    std::stable_sort(properties.begin(), properties.end(),
+                     [](const Property& a, const Property& b) { return a.hash < b.hash; });
+
+    rule.first_property = (uint32_t)m_properties.size();
+    rule.property_count = (uint32_t)properties.size();
+    for (auto& property : properties)
+        m_properties.push_back(std::move(property));
+
+    m_rules.push_back(rule);
+    return (uint32_t)(m_rules.size() - 1);
+}
+
+std::vector<SchemaReport> Schema::validate(const YAMLNode& root, unsigned threads) const
+{
+    if (threads == 0)
+        threads = ThreadPool::defaultThreads();
+
+    std::vector<Walker::Unit> units;
+    units.push_back(Walker::Unit{&root, m_root, std::string(), {}});
+
+    // The top levels are checked here, each level splitting the tree into more subtrees
+    Walker top(*this, false);
+    for (unsigned level = 0; threads > 1 && level < MAX_SPLIT_LEVELS; ++level) {
+        if (units.empty() || units.size() >= threads * UNITS_PER_THREAD)
+            break;
+
+        std::vector<Walker::Unit> next;
+        for (const auto& unit : units)
+            top.check(unit, &next);
+        units = std::move(next);
+    }
+
+    std::vector<Walker> walkers(std::min<size_t>(threads, std::max<size_t>(units.size(), 1)), Walker(*this, false));
+    if (walkers.size() == 1) {
+        for (const auto& unit : units)
+            walkers[0].check(unit);
+    } else {
+        // Workers take the next subtree as they finish one, so large ones do not hold up the rest
+        std::atomic<size_t> next_unit{0};
+        std::vector<std::future<void>> results;
+        ThreadPool pool((unsigned)walkers.size());
+
+        for (auto& walker : walkers) {
+            auto task = std::make_shared<std::packaged_task<void()>>([&units, &next_unit, &walker] {
+                for (size_t i = next_unit++; i < units.size(); i = next_unit++)
+                    walker.check(units[i]);
+            });
+
+            results.push_back(task->get_future());
+            pool.submit([task] { (*task)(); });
+        }
+
+        for (auto& result : results)
+            result.get();
+    }
+
+    // Positions are unique to a subtree, so sorting gives the same order however it was split
+    std::vector<Walker::Found> found = std::move(top.found());
+    for (auto& walker : walkers) {
+        for (auto& item : walker.found())
+            found.push_back(std::move(item));
+    }
+    std::stable_sort(found.begin(), found.end(), [](const Walker::Found& a, const Walker::Found& b) {
+        return a.position < b.position;
+    });
+
+    std::vector<SchemaReport> reports;
+    reports.reserve(found.size());
+    for (auto& item : found)
+        reports.push_back(std::move(item.report));
+    return reports;
+}
+
+// Hash is keyHash() of key, which tree nodes store already
+const Schema::Property* Schema::findProperty(const Rule& rule, std::string_view key, uint32_t hash) const
+{
+    const Property* first = m_properties.data() + rule.first_property;
+    const Property* last = first + rule.property_count;
+
+    auto it = std::lower_bound(first, last, hash, [](const Property& property, uint32_t value) {
+        return property.hash < value;
+    });
+    for (; it != last && it->hash == hash; ++it) {
+        if (it->key == key)
+            return it;
+    }
+    return nullptr;
+}
+
+// Scalars are only read as numbers when a type or a range asks for it
+SchemaViolation Schema::checkScalar(const Rule& rule, std::string_view text) const
+{
+    bool ranged = rule.minimum > -HUGE_VAL || rule.maximum < HUGE_VAL;
+    bool wants_number = (rule.types & NUMBER_TYPE) && !(rule.types & STRING_TYPE);
+    double number = 0;
+    bool is_number = (ranged || wants_number) && numberOf(text, number);
+
+    bool typed = (rule.types & STRING_TYPE)
+                 || ((rule.types & NULL_TYPE) && isNull(text))
+                 || ((rule.types & BOOL_TYPE) && YAMLResult<bool>::parse(text))
+                 || ((rule.types & INTEGER_TYPE) && YAMLResult<int64_t>::parse(text))
+                 || ((rule.types & INTEGER_TYPE) && YAMLResult<uint64_t>::parse(text))
+                 || ((rule.types & NUMBER_TYPE) && is_number);
+    if (!typed)
+        return SchemaViolation::WrongType;
+
+    if (rule.enum_count > 0) {
+        auto first = m_enums.begin() + rule.first_enum;
+        if (std::find(first, first + rule.enum_count, text) == first + rule.enum_count)
+            return SchemaViolation::NotInEnum;
+    }
+
+    if (is_number && (number < rule.minimum || number > rule.maximum))
+        return SchemaViolation::OutOfRange;
+
+    if (text.size() < rule.min_size || text.size() > rule.max_size)
+        return SchemaViolation::WrongSize;
+
+    return SchemaViolation::None;
+}
+
+void Schema::Walker::check(const Unit& unit, std::vector<Unit>* children)
+{
+    m_path = unit.path;
+    m_position = unit.position;
+    check(*unit.node, unit.rule, children);
+}
+
+void Schema::Walker::check(const YAMLNode& node, uint32_t index, std::vector<Unit>* children)
+{
+    if (index == ANY_RULE || done())
+        return;
+
+    const YAMLNode& target = node.resolved();
+    const Rule& rule = m_schema->m_rules[index];
+
+    if (target.isScalar()) {
+        SchemaViolation violation = m_schema->checkScalar(rule, target.asScalar());
+        if (violation != SchemaViolation::None)
+            report(violation);
+        return;
+    }
+
+    bool is_mapping = target.isMapping();
+    if (!(rule.types & (is_mapping ? MAPPING_TYPE : SEQUENCE_TYPE))) {
+        report(SchemaViolation::WrongType);
+        return;
+    }
+
+    // Merged entries are checked after the mapping's own, as if written at its end
+    std::vector<const YAMLNode*> merged;
+    if (is_mapping)
+        mergedEntries(target, merged);
+
+    size_t own = target.size();
+    size_t entries = own + merged.size();
+    for (size_t i = 0; i < own; ++i) {
+        if (is_mapping && target[i].getKey() == "<<")
+            entries--;
+    }
+    if (entries < rule.min_size || entries > rule.max_size)
+        report(SchemaViolation::WrongSize);
+
+    std::vector<bool> seen(rule.required_count);
+    for (size_t i = 0; i < own + merged.size() && !done(); ++i) {
+        const YAMLNode& child = i < own ? target[i] : *merged[i - own];
+        if (is_mapping && child.getKey() == "<<")
+            continue;
+
+        uint32_t child_rule = rule.items;
+        size_t path_size = m_path.size();
+
+        if (is_mapping) {
+            const Property* property = m_schema->findProperty(rule, child.getKey(), child.getKeyHash());
+            child_rule = property ? property->rule : rule.additional;
+            if (property && property->required != NOT_REQUIRED)
+                seen[property->required] = true;
+
+            if (!m_path.empty())
+                m_path += '.';
+            m_path += child.getKey();
+        } else {
+            m_path += "[" + std::to_string(i) + "]";
+        }
+        m_position.push_back((uint32_t)i);
+
+        if (child_rule == NO_RULE)
+            report(SchemaViolation::UnknownKey);
+        else if (children && child_rule != ANY_RULE)
+            children->push_back(Unit{&child, child_rule, m_path, m_position});
+        else
+            check(child, child_rule);
+
+        m_path.resize(path_size);
+        m_position.pop_back();
+    }
+
+    for (uint32_t i = 0; i < rule.property_count && !done(); ++i) {
+        const Property& property = m_schema->m_properties[rule.first_property + i];
+        if (property.required != NOT_REQUIRED && !seen[property.required])
+            report(SchemaViolation::MissingKey, property.key);
+    }
+}
+
+void Schema::Walker::mergedEntries(const YAMLNode& mapping, std::vector<const YAMLNode*>& out)
+{
+    const YAMLNode& node = mapping.resolved();
+
+    std::vector<const YAMLNode*> sources;
+    for (size_t i = 0; i < node.size(); ++i) {
+        const YAMLNode& child = node[i];
+        if (child.getKey() != "<<")
+            continue;
+
+        if (child.isMapping()) {
+            sources.push_back(&child);
+        } else if (child.isSequence()) {
+            for (size_t j = 0; j < child.size(); ++j) {
+                if (child[j].isMapping())
+                    sources.push_back(&child[j]);
+            }
+        }
+    }
+    if (sources.empty())
+        return;
+
+    std::unordered_set<std::string_view> keys;
+    for (size_t i = 0; i < node.size(); ++i)
+        keys.insert(node[i].getKey());
+
+    for (const YAMLNode* source : sources) {
+        std::vector<const YAMLNode*> entries;
+        const YAMLNode& target = source->resolved();
+        for (size_t i = 0; i < target.size(); ++i) {
+            if (target[i].getKey() != "<<")
+                entries.push_back(&target[i]);
+        }
+        mergedEntries(target, entries);
+
+        for (const YAMLNode* entry : entries) {
+            if (keys.insert(entry->getKey()).second)
+                out.push_back(entry);
+        }
+    }
+}
+
+void Schema::Walker::report(SchemaViolation violation, std::string_view key)
+{
+    std::string path = m_path;
+    if (!key.empty()) {
+        if (!path.empty())
+            path += '.';
+        path += key;
+    }
+    m_found.push_back(Found{m_position, SchemaReport{violation, std::move(path)}});
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,249 @@
+#include "SchemaValidator.hpp"
+#include "EmbedYAML/KeyHash.hpp"
+#include "SchemaWalker.hpp"
+
+namespace EmbedYAML {
+
+void SchemaValidator::setSchema(const Schema* schema)
+{
+    m_schema = schema;
+    reset();
+}
+
+void SchemaValidator::reset()
+{
+    m_stack.clear();
+    m_seen.clear();
+    m_report = SchemaReport();
+}
+
+bool SchemaValidator::scalar(std::string_view text)
+{
+    if (expectsKey())
+        return key(text);
+
+    uint32_t index = Schema::ANY_RULE;
+    if (!beginValue(index) || !checkScalar(index, text))
+        return false;
+
+    endValue();
+    return true;
+}
+
+// Aliases repeat a node built earlier, which is checked as a whole against the rule here
+bool SchemaValidator::alias(const YAMLNode* node)
+{
+    if (expectsKey()) {
+        bool scalar_key = node && node->isScalar();
+        return key(scalar_key ? std::string_view(node->asScalar()) : std::string_view());
+    }
+
+    uint32_t index = Schema::ANY_RULE;
+    if (!beginValue(index))
+        return false;
+    if (!(node ? checkNode(index, *node) : checkScalar(index, std::string_view())))
+        return false;
+
+    endValue();
+    return true;
+}
+
+bool SchemaValidator::start(bool is_mapping)
+{
+    if (expectsKey()) {
+        m_stack.push_back(Frame{Schema::ANY_RULE, Schema::ANY_RULE, 0, m_seen.size(), {}, {}, is_mapping, true, false, false});
+        return true;
+    }
+
+    uint32_t index = Schema::ANY_RULE;
+    if (!beginValue(index) || !checkCollection(index, is_mapping))
+        return false;
+
+    m_stack.push_back(Frame{index, Schema::ANY_RULE, 0, m_seen.size(), {}, {}, is_mapping, false, false, false});
+    if (is_mapping)
+        m_seen.resize(m_seen.size() + (rule(index).required_count + 63) / 64, 0);
+    return true;
+}
+
+bool SchemaValidator::end(const YAMLNode* node)
+{
+    Frame& top = m_stack.back();
+
+    // The builder reads a complex key as an empty one
+    if (top.is_key) {
+        m_seen.resize(top.seen);
+        m_stack.pop_back();
+        return key(std::string_view());
+    }
+
+    if (top.merges && node && !checkMerged(*node))
+        return false;
+
+    const Rule& current = rule(top.rule);
+    if (top.count < current.min_size)
+        return fail(SchemaViolation::WrongSize);
+
+    if (top.is_mapping && current.required_count > 0) {
+        for (uint32_t i = 0; i < current.property_count; ++i) {
+            const Property& property = m_schema->m_properties[current.first_property + i];
+            if (property.required == Schema::NOT_REQUIRED)
+                continue;
+            if (!(m_seen[top.seen + property.required / 64] >> (property.required % 64) & 1))
+                return fail(SchemaViolation::MissingKey, property.key);
+        }
+    }
+
+    m_seen.resize(top.seen);
+    m_stack.pop_back();
+    endValue();
+    return true;
+}
+
+bool SchemaValidator::expectsKey() const
+{
+    return !m_stack.empty() && m_stack.back().is_mapping && !m_stack.back().in_value;
+}
+
+bool SchemaValidator::key(std::string_view text)
+{
+    Frame& top = m_stack.back();
+    const Rule& current = rule(top.rule);
+
+    // The value of a merge is only checked through the entries it adds, see end()
+    if (text == "<<") {
+        top.in_value = true;
+        top.merges = true;
+        top.child = Schema::ANY_RULE;
+        top.key = std::string_view();
+        top.owned_key.clear();
+        return true;
+    }
+
+    top.count++;
+    top.in_value = true;
+    top.key = text;
+    top.owned_key.clear();
+    if (top.count > current.max_size)
+        return fail(SchemaViolation::WrongSize);
+
+    if (const Property* property = m_schema->findProperty(current, text, keyHash(text))) {
+        top.key = property->key;
+        top.child = property->rule;
+        if (property->required != Schema::NOT_REQUIRED)
+            m_seen[top.seen + property->required / 64] |= uint64_t(1) << (property->required % 64);
+        return true;
+    }
+
+    if (current.additional == Schema::NO_RULE)
+        return fail(SchemaViolation::UnknownKey);
+
+    // Values accepted as is never report a path, so only keys checked by a rule are kept
+    top.child = current.additional;
+    top.key = std::string_view();
+    if (current.additional != Schema::ANY_RULE)
+        top.owned_key.assign(text.data(), text.size());
+    return true;
+}
+
+bool SchemaValidator::beginValue(uint32_t& index)
+{
+    if (m_stack.empty()) {
+        index = m_schema->m_root;
+        return true;
+    }
+
+    Frame& top = m_stack.back();
+    if (top.is_mapping) {
+        index = top.child;
+        return true;
+    }
+
+    const Rule& current = rule(top.rule);
+    top.count++;
+    top.in_value = true;
+    if (top.count > current.max_size)
+        return fail(SchemaViolation::WrongSize);
+
+    index = current.items;
+    return true;
+}
+
+void SchemaValidator::endValue()
+{
+    if (!m_stack.empty())
+        m_stack.back().in_value = false;
+}
+
+bool SchemaValidator::checkScalar(uint32_t index, std::string_view text)
+{
+    if (index == Schema::ANY_RULE)
+        return true;
+
+    SchemaViolation violation = m_schema->checkScalar(rule(index), text);
+    return violation == SchemaViolation::None ? true : fail(violation);
+}
+
+bool SchemaValidator::checkCollection(uint32_t index, bool is_mapping)
+{
+    uint8_t type = is_mapping ? Schema::MAPPING_TYPE : Schema::SEQUENCE_TYPE;
+    return (rule(index).types & type) ? true : fail(SchemaViolation::WrongType);
+}
+
+// The node an alias repeats is checked as a whole, its violations reported below the alias
+bool SchemaValidator::checkNode(uint32_t index, const YAMLNode& node)
+{
+    Schema::Walker walker(*m_schema, true);
+    walker.check(node, index);
+    if (walker.found().empty())
+        return true;
+
+    const SchemaReport& first = walker.found().front().report;
+    return fail(first.violation, first.path);
+}
+
+// Merged entries are read as keys and values written at the end of the mapping
+bool SchemaValidator::checkMerged(const YAMLNode& mapping)
+{
+    std::vector<const YAMLNode*> merged;
+    Schema::Walker::mergedEntries(mapping, merged);
+
+    for (const YAMLNode* entry : merged) {
+        if (!key(entry->getKey()))
+            return false;
+        if (m_stack.back().child != Schema::ANY_RULE && !checkNode(m_stack.back().child, *entry))
+            return false;
+        endValue();
+    }
+    return true;
+}
+
+// The path runs through the current key or item of every open collection
+bool SchemaValidator::fail(SchemaViolation violation, std::string_view key)
+{
+    m_report.violation = violation;
+    m_report.path.clear();
+
+    for (const auto& frame : m_stack) {
+        if (!frame.in_value)
+            continue;
+
+        if (!frame.is_mapping) {
+            m_report.path += "[" + std::to_string(frame.count - 1) + "]";
+            continue;
+        }
+
+        if (!m_report.path.empty())
+            m_report.path += '.';
+        m_report.path += frame.owned_key.empty() ? frame.key : std::string_view(frame.owned_key);
+    }
+
+    if (!key.empty()) {
+        if (!m_report.path.empty() && key[0] != '[')
+            m_report.path += '.';
+        m_report.path += key;
+    }
+
+    return false;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "EmbedYAML/Schema.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Checks parse events against a compiled Schema as they arrive, keeping one frame per open
+// collection. Only the required keys of open mappings are remembered, so the cost does not
+// grow with the document.
+class SchemaValidator {
+public:
+    // A null schema checks nothing
+    void setSchema(const Schema* schema);
+    bool enabled() const { return m_schema != nullptr; }
+
+    // Starts over for another document
+    void reset();
+
+    // Each returns false once the document broke the schema, see report()
+    bool scalar(std::string_view text);
+    bool alias(const YAMLNode* node);   // Null for an unknown anchor, which reads as an empty scalar
+    bool start(bool is_mapping);
+    bool end(const YAMLNode* node);     // The complete collection, whose "<<" merges are checked here
+
+    const SchemaReport& report() const { return m_report; }
+
+private:
+    using Rule = Schema::Rule;
+    using Property = Schema::Property;
+
+    struct Frame {
+        uint32_t rule;
+        uint32_t child;         // Rule of the value under the current key
+        size_t count;           // Entries or items so far
+        size_t seen;            // First word of the mapping's required keys in m_seen
+        std::string_view key;   // Current key, owned by the schema unless owned_key is set
+        std::string owned_key;  // Copy of a key outside the properties, checked by a rule of its own
+        bool is_mapping;
+        bool is_key;            // Complex key, accepted as is and read as an empty key
+        bool in_value;          // Inside the value of key or the item at count - 1
+        bool merges;            // A "<<" key was read, its entries are checked as the mapping ends
+    };
+
+    const Rule& rule(uint32_t index) const { return m_schema->m_rules[index]; }
+
+    bool expectsKey() const;
+    bool key(std::string_view text);
+    bool beginValue(uint32_t& index);
+    void endValue();
+
+    bool checkScalar(uint32_t index, std::string_view text);
+    bool checkCollection(uint32_t index, bool is_mapping);
+    bool checkNode(uint32_t index, const YAMLNode& node);
+    bool checkMerged(const YAMLNode& mapping);
+
+    // Key, or a path relative to the current node, is appended to the reported path
+    bool fail(SchemaViolation violation, std::string_view key = std::string_view());
+
+    const Schema* m_schema = nullptr;
+    std::vector<Frame> m_stack;
+    std::vector<uint64_t> m_seen;
+    SchemaReport m_report;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "EmbedYAML/Schema.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Checks a built tree against the rules of a schema. Violations carry the child indices
+// leading to them, so the lists of walkers checking separate subtrees merge in document order.
+class Schema::Walker {
+public:
+    struct Found {
+        std::vector<uint32_t> position;
+        SchemaReport report;
+    };
+
+    // A subtree left to check, with the path and position of its root
+    struct Unit {
+        const YAMLNode* node;
+        uint32_t rule;
+        std::string path;
+        std::vector<uint32_t> position;
+    };
+
+    // A walker for the first violation only stops there
+    Walker(const Schema& schema, bool first_only) : m_schema(&schema), m_first_only(first_only) {}
+
+    // Checks node and everything below it, or when children is given only node itself,
+    // appending its children to check later
+    void check(const YAMLNode& node, uint32_t rule, std::vector<Unit>* children = nullptr);
+    void check(const Unit& unit, std::vector<Unit>* children = nullptr);
+
+    std::vector<Found>& found() { return m_found; }
+
+    // Appends the entries the "<<" merges of a mapping add to it: the keys of every merge
+    // source in turn, earlier sources first, that neither the mapping nor an earlier source has
+    static void mergedEntries(const YAMLNode& mapping, std::vector<const YAMLNode*>& out);
+
+private:
+    bool done() const { return m_first_only && !m_found.empty(); }
+    void report(SchemaViolation violation, std::string_view key = std::string_view());
+
+    const Schema* m_schema;
+    bool m_first_only;
+    std::string m_path;
+    std::vector<uint32_t> m_position;
+    std::vector<Found> m_found;
+};
+
+} // namespace EmbedYAML
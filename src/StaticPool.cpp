@@ -0,0 +1,247 @@
+#include "EmbedYAML/StaticPool.hpp"
+#include "EmbedYAML/Exceptions.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace EmbedYAML {
+
+namespace {
+
+// Each block starts with its size class, padded so the payload keeps the strictest alignment
+constexpr size_t HEADER = alignof(std::max_align_t);
+constexpr unsigned MIN_CLASS = 5;
+
+std::atomic<StaticPool*> g_installed(nullptr);
+
+unsigned sizeClass(size_t size)
+{
+    unsigned size_class = MIN_CLASS;
+    while (((size_t)1 << size_class) < size)
+        size_class++;
+    return size_class;
+}
+
+} // namespace
+
+StaticPool::Lock::Lock(std::atomic_flag& flag)
+    : m_flag(flag)
+{
+    while (m_flag.test_and_set(std::memory_order_acquire)) {
+    }
+}
+
+StaticPool::Lock::~Lock()
+{
+    m_flag.clear(std::memory_order_release);
+}
+
+StaticPool::StaticPool(void* buffer, size_t size)
+{
+    uintptr_t begin = (uintptr_t)buffer;
+    uintptr_t aligned = (begin + HEADER - 1) & ~(uintptr_t)(HEADER - 1);
+
+    m_begin = (unsigned char*)buffer + (aligned - begin);
+    m_end = size > aligned - begin ? (unsigned char*)buffer + size : m_begin;
+    m_top = m_begin;
+}
+
+void* StaticPool::allocate(size_t size)
+{
+    if (size > capacity())
+        return nullptr;
+
+    unsigned size_class = sizeClass(size + HEADER);
+    Lock lock(m_lock);
+
+    // A freed block of the same class first, then fresh space, then a larger freed block used whole
+    unsigned char* block = nullptr;
+    for (unsigned candidate = size_class; candidate < CLASSES; ++candidate) {
+        if (m_free[candidate]) {
+            block = (unsigned char*)m_free[candidate];
+            m_free[candidate] = *(void**)block;
+            size_class = candidate;
+            break;
+        }
+
+        if (candidate == size_class && (size_t)(m_end - m_top) >= ((size_t)1 << size_class)) {
+            block = m_top;
+            m_top += (size_t)1 << size_class;
+            break;
+        }
+    }
+
+    if (!block)
+        return nullptr;
+
+    *(size_t*)block = size_class;
+    m_used += (size_t)1 << size_class;
+    if (m_used > m_peak)
+        m_peak = m_used;
+
+    return block + HEADER;
+}
+
+void StaticPool::deallocate(void* ptr)
+{
+    if (!ptr)
+        return;
+
+    unsigned char* block = (unsigned char*)ptr - HEADER;
+    size_t size_class = *(size_t*)block;
+
+    Lock lock(m_lock);
+    *(void**)block = m_free[size_class];
+    m_free[size_class] = block;
+    m_used -= (size_t)1 << size_class;
+}
+
+void StaticPool::install(StaticPool* pool)
+{
+    g_installed.store(pool, std::memory_order_release);
+}
+
+StaticPool* StaticPool::installed()
+{
+    return g_installed.load(std::memory_order_acquire);
+}
+
+} // namespace EmbedYAML
+
+#ifdef EMBEDYAML_STATIC_POOL
+
+// Replacements for the global allocation functions, the heap is only used while no pool is installed
+
+namespace {
+
+// Over-aligned blocks are cut from a larger one, whose address is kept just below the payload
+void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+    std::size_t padding = (std::size_t)alignment + sizeof(void*);
+    if (size > SIZE_MAX - padding)
+        return nullptr;
+
+    void* block = ::operator new(size + padding, std::nothrow);
+    if (!block)
+        return nullptr;
+
+    uintptr_t payload = ((uintptr_t)block + sizeof(void*) + (std::size_t)alignment - 1)
+        & ~(uintptr_t)((std::size_t)alignment - 1);
+    ((void**)payload)[-1] = block;
+    return (void*)payload;
+}
+
+} // namespace
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    if (EmbedYAML::StaticPool* pool = EmbedYAML::StaticPool::installed())
+        return pool->allocate(size);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, tag);
+}
+
+void* operator new(std::size_t size)
+{
+    if (void* ptr = ::operator new(size, std::nothrow))
+        return ptr;
+    EMBEDYAML_THROW(std::bad_alloc());
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, alignment, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* ptr = allocateAligned(size, alignment))
+        return ptr;
+    EMBEDYAML_THROW(std::bad_alloc());
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    EmbedYAML::StaticPool* pool = EmbedYAML::StaticPool::installed();
+    if (pool && pool->owns(ptr))
+        pool->deallocate(ptr);
+    else
+        std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    ::operator delete(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept
+{
+    if (ptr)
+        ::operator delete(((void**)ptr)[-1]);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept
+{
+    ::operator delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+    ::operator delete(ptr, alignment);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    ::operator delete(ptr, alignment);
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    ::operator delete(ptr, alignment);
+}
+
+#endif
@@ -0,0 +1,197 @@
+#include "StructuralIndex.hpp"
+#include "CpuFeatures.hpp"
+
+namespace EmbedYAML {
+
+namespace {
+
+// One bit per byte of a 64-byte block
+struct BlockMasks {
+    uint64_t line_break;
+    uint64_t blank;
+    uint64_t colon;
+    uint64_t dash;
+    uint64_t hash;
+    uint64_t quote;
+    uint64_t escape;
+};
+
+using ClassifyFunction = void (*)(const char* block, BlockMasks& masks);
+
+void classifyPortable(const char* block, BlockMasks& masks)
+{
+    masks = BlockMasks{0, 0, 0, 0, 0, 0, 0};
+
+    for (unsigned i = 0; i < 64; ++i) {
+        uint64_t bit = uint64_t(1) << i;
+        switch (block[i])
+        {
+        case '\n':
+        case '\r':
+            masks.line_break |= bit;
+            masks.blank |= bit;
+            break;
+        case ' ':
+        case '\t':
+            masks.blank |= bit;
+            break;
+        case ':':
+            masks.colon |= bit;
+            break;
+        case '-':
+            masks.dash |= bit;
+            break;
+        case '#':
+            masks.hash |= bit;
+            break;
+        case '"':
+        case '\'':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.escape |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+#ifdef EMBEDYAML_X86_KERNELS
+
+__attribute__((target("sse2")))
+uint64_t matchSSE2(const __m128i chunks[4], char c)
+{
+    __m128i needle = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (unsigned i = 0; i < 4; ++i)
+        mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunks[i], needle)) << (i * 16);
+    return mask;
+}
+
+__attribute__((target("sse2")))
+void classifySSE2(const char* block, BlockMasks& masks)
+{
+    __m128i chunks[4];
+    for (unsigned i = 0; i < 4; ++i)
+        chunks[i] = _mm_loadu_si128((const __m128i*)(block + i * 16));
+
+    masks.line_break = matchSSE2(chunks, '\n') | matchSSE2(chunks, '\r');
+    masks.blank = masks.line_break | matchSSE2(chunks, ' ') | matchSSE2(chunks, '\t');
+    masks.colon = matchSSE2(chunks, ':');
+    masks.dash = matchSSE2(chunks, '-');
+    masks.hash = matchSSE2(chunks, '#');
+    masks.quote = matchSSE2(chunks, '"') | matchSSE2(chunks, '\'');
+    masks.escape = matchSSE2(chunks, '\\');
+}
+
+__attribute__((target("avx2")))
+uint64_t matchAVX2(__m256i low, __m256i high, char c)
+{
+    __m256i needle = _mm256_set1_epi8(c);
+    uint64_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, needle));
+    uint64_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, needle));
+    return lo | (hi << 32);
+}
+
+__attribute__((target("avx2")))
+void classifyAVX2(const char* block, BlockMasks& masks)
+{
+    __m256i low = _mm256_loadu_si256((const __m256i*)block);
+    __m256i high = _mm256_loadu_si256((const __m256i*)(block + 32));
+
+    masks.line_break = matchAVX2(low, high, '\n') | matchAVX2(low, high, '\r');
+    masks.blank = masks.line_break | matchAVX2(low, high, ' ') | matchAVX2(low, high, '\t');
+    masks.colon = matchAVX2(low, high, ':');
+    masks.dash = matchAVX2(low, high, '-');
+    masks.hash = matchAVX2(low, high, '#');
+    masks.quote = matchAVX2(low, high, '"') | matchAVX2(low, high, '\'');
+    masks.escape = matchAVX2(low, high, '\\');
+}
+
+#endif
+
+ClassifyFunction selectKernel()
+{
+    switch (simdLevel())
+    {
+#ifdef EMBEDYAML_X86_KERNELS
+    case SimdLevel::AVX2:
+        return classifyAVX2;
+    case SimdLevel::SSE2:
+        return classifySSE2;
+#endif
+    default:
+        return classifyPortable;
+    }
+}
+
+bool isBlankByte(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+unsigned countTrailingZeros(uint64_t value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned count = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+} // namespace
+
+bool StructuralIndex::build(const char* data, size_t length)
+{
+    m_positions.clear();
+    if (length > UINT32_MAX)
+        return false;
+
+    static const ClassifyFunction classify = selectKernel();
+    m_positions.reserve(length / 8);
+
+    // The start of input counts as following a blank, the end as preceding one
+    uint64_t previous_blank = 1;
+    char tail[64];
+
+    for (size_t offset = 0; offset < length; offset += 64) {
+        const char* block = data + offset;
+        size_t remaining = length - offset;
+
+        if (remaining < 64) {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, remaining);
+            block = tail;
+        }
+
+        BlockMasks masks;
+        classify(block, masks);
+
+        uint64_t next_blank = remaining > 64 ? isBlankByte(data[offset + 64]) : 1;
+        uint64_t blank_after = (masks.blank >> 1) | (next_blank << 63);
+        uint64_t blank_before = (masks.blank << 1) | previous_blank;
+        previous_blank = masks.blank >> 63;
+
+        uint64_t structural = masks.line_break | masks.quote | masks.escape
+            | ((masks.colon | masks.dash) & blank_after)
+            | (masks.hash & blank_before);
+
+        if (remaining < 64)
+            structural &= (uint64_t(1) << remaining) - 1;
+
+        while (structural) {
+            m_positions.push_back((uint32_t)(offset + countTrailingZeros(structural)));
+            structural &= structural - 1;
+        }
+    }
+
+    return true;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Offsets of the bytes that drive block-level scanning, in input order: line breaks
+// ('\n' and '\r'), ':' and '-' followed by a blank, '#' preceded by a blank, both
+// quote characters and the '\\' escape. Built 64 bytes at a time with the widest
+// kernel the CPU supports.
+class StructuralIndex {
+public:
+    // False when the input is too large for 32-bit offsets
+    bool build(const char* data, size_t length);
+
+    const std::vector<uint32_t>& positions() const { return m_positions; }
+
+private:
+    std::vector<uint32_t> m_positions;
+};
+
+// Forward-only search over an index, each entry is passed over at most a few times
+class StructuralCursor {
+public:
+    StructuralCursor(const char* base, const StructuralIndex& index)
+        : m_base(base), m_positions(index.positions()) {}
+
+    // First indexed byte in [from, limit) that is one of chars, or limit
+    const char* find(const char* from, const char* limit, const char* chars) {
+        while (m_next < m_positions.size() && m_base + m_positions[m_next] < from)
+            m_next++;
+
+        for (size_t i = m_next; i < m_positions.size(); ++i) {
+            const char* p = m_base + m_positions[i];
+            if (p >= limit)
+                break;
+            if (std::strchr(chars, *p))
+                return p;
+        }
+
+        return limit;
+    }
+
+private:
+    const char* m_base;
+    const std::vector<uint32_t>& m_positions;
+    size_t m_next = 0;
+};
+
+} // namespace EmbedYAML
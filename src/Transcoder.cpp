@@ -0,0 +1,300 @@
+#include "Transcoder.hpp"
+#include "EmbedYAML/Exceptions.hpp"
+#include "EmbedYAML/YAMLResult.hpp"
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace EmbedYAML {
+
+namespace {
+
+constexpr size_t NO_ANCHOR = std::numeric_limits<size_t>::max();
+
+bool exceeds(size_t value, size_t limit)
+{
+    return limit && value > limit;
+}
+
+ParseError failure(const YAMLEventReader& reader)
+{
+    return reader.error() != ParseError::None ? reader.error() : ParseError::Syntax;
+}
+
+std::string_view scalarText(const yaml_event_t& event)
+{
+    return std::string_view((const char*)event.data.scalar.value, event.data.scalar.length);
+}
+
+// Quoted scalars and those tagged !!str or ! are strings whatever they spell
+bool isString(const yaml_event_t& event)
+{
+    if (event.data.scalar.style != YAML_PLAIN_SCALAR_STYLE)
+        return true;
+
+    const char* tag = (const char*)event.data.scalar.tag;
+    return tag && (std::strcmp(tag, "tag:yaml.org,2002:str") == 0 || std::strcmp(tag, "!") == 0);
+}
+
+} // namespace
+
+ScalarValue resolveScalar(std::string_view text, bool quoted)
+{
+    ScalarValue value;
+    if (quoted)
+        return value;
+
+    if (text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL") {
+        value.type = ScalarValue::Type::Null;
+    } else if (YAMLResult<bool> result = YAMLResult<bool>::parse(text)) {
+        value.type = ScalarValue::Type::Bool;
+        value.boolean = result.value();
+    } else if (YAMLResult<int64_t> result = YAMLResult<int64_t>::parse(text)) {
+        value.type = ScalarValue::Type::Int;
+        value.integer = result.value();
+    } else if (YAMLResult<uint64_t> result = YAMLResult<uint64_t>::parse(text)) {
+        value.type = ScalarValue::Type::UInt;
+        value.unsigned_integer = result.value();
+    } else if (YAMLResult<double> result = YAMLResult<double>::parse(text)) {
+        value.type = ScalarValue::Type::Float;
+        value.real = result.value();
+    }
+    return value;
+}
+
+ParseError Transcoder::run(YAMLEventReader& reader)
+{
+    EMBEDYAML_TRY {
+        while (reader.next()) {
+            if (reader.type() != YAML_DOCUMENT_START_EVENT)
+                continue;
+
+            ParseError error = document(reader);
+            if (error != ParseError::None)
+                return error;
+        }
+    } EMBEDYAML_CATCH(const std::bad_alloc&) {
+        return ParseError::OutOfMemory;
+    }
+
+    return reader.error();
+}
+
+// Anchors and limits start over with every document
+ParseError Transcoder::document(YAMLEventReader& reader)
+{
+    m_stack.clear();
+    m_tokens.clear();
+    m_text.clear();
+    m_anchors.clear();
+    m_anchor_names.clear();
+    m_recordings.clear();
+    m_nodes = 0;
+    m_scalar_bytes = 0;
+    m_alias_expansions = 0;
+
+    while (reader.next()) {
+        if (reader.type() == YAML_DOCUMENT_END_EVENT) {
+            writeDocumentEnd();
+            return outputError();
+        }
+
+        ParseError error = event(reader.event());
+        if (error != ParseError::None)
+            return error;
+    }
+
+    return failure(reader);
+}
+
+ParseError Transcoder::event(const yaml_event_t& event)
+{
+    size_t first = m_tokens.size();
+
+    switch (event.type)
+    {
+    case YAML_SCALAR_EVENT: {
+        std::string_view text = scalarText(event);
+        m_scalar_bytes += text.size();
+        if (exceeds(++m_nodes, m_limits.max_nodes))
+            return ParseError::TooManyNodes;
+        if (exceeds(m_scalar_bytes, m_limits.max_scalar_bytes))
+            return ParseError::ScalarBytesExceeded;
+
+        bool quoted = isString(event);
+        if (!m_recordings.empty() || event.data.scalar.anchor)
+            record(quoted ? TokenKind::QuotedScalar : TokenKind::Scalar, text);
+        if (event.data.scalar.anchor)
+            anchor(event.data.scalar.anchor, first);
+        return scalar(text, quoted);
+    }
+    case YAML_ALIAS_EVENT: {
+        if (exceeds(++m_nodes, m_limits.max_nodes))
+            return ParseError::TooManyNodes;
+
+        auto it = m_anchor_names.find((const char*)event.data.alias.anchor);
+        size_t index = it != m_anchor_names.end() ? it->second : NO_ANCHOR;
+        if (!m_recordings.empty()) {
+            record(TokenKind::Alias);
+            m_tokens.back().offset = index;
+        }
+        return alias(index);
+    }
+    case YAML_MAPPING_START_EVENT:
+    case YAML_SEQUENCE_START_EVENT: {
+        if (exceeds(++m_nodes, m_limits.max_nodes))
+            return ParseError::TooManyNodes;
+
+        bool is_mapping = event.type == YAML_MAPPING_START_EVENT;
+        const yaml_char_t* name = is_mapping ? event.data.mapping_start.anchor : event.data.sequence_start.anchor;
+        if (name)
+            m_recordings.push_back(Recording{(const char*)name, first, m_stack.size()});
+        if (!m_recordings.empty())
+            record(is_mapping ? TokenKind::MappingStart : TokenKind::SequenceStart);
+        return start(is_mapping);
+    }
+    case YAML_MAPPING_END_EVENT:
+    case YAML_SEQUENCE_END_EVENT: {
+        if (!m_recordings.empty())
+            record(TokenKind::End);
+
+        ParseError error = end();
+        finishRecordings();
+        return error;
+    }
+    default:
+        return ParseError::None;
+    }
+}
+
+ParseError Transcoder::scalar(std::string_view text, bool quoted)
+{
+    // Keys are text whatever they spell
+    if (!m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key) {
+        Frame& top = m_stack.back();
+        if (top.count++ > 0)
+            writeSeparator();
+        writeKey(text);
+        top.expect_key = false;
+        return ParseError::None;
+    }
+
+    beginValue();
+    writeScalar(text, quoted);
+    endValue();
+    return ParseError::None;
+}
+
+// Writes the anchored node out again, unknown anchors read as an empty scalar like in a tree
+ParseError Transcoder::alias(size_t anchor)
+{
+    if (exceeds(++m_alias_expansions, m_limits.max_alias_expansions))
+        return ParseError::AliasExpansionsExceeded;
+    if (anchor == NO_ANCHOR)
+        return scalar(std::string_view(), false);
+
+    Anchor range = m_anchors[anchor];
+    bool expect_key = !m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key;
+    if (expect_key && range.last - range.first > 1)
+        return ParseError::Unsupported;
+
+    for (size_t i = range.first; i < range.last; ++i) {
+        const Token& token = m_tokens[i];
+        ParseError error = ParseError::None;
+
+        // The first node of the range was counted for the alias itself
+        if (i > range.first && token.kind != TokenKind::End && token.kind != TokenKind::Alias
+            && exceeds(++m_alias_expansions, m_limits.max_alias_expansions))
+            return ParseError::AliasExpansionsExceeded;
+
+        switch (token.kind)
+        {
+        case TokenKind::Scalar:
+        case TokenKind::QuotedScalar:
+            error = scalar(std::string_view(m_text.data() + token.offset, token.length),
+                           token.kind == TokenKind::QuotedScalar);
+            break;
+        case TokenKind::MappingStart:
+        case TokenKind::SequenceStart:
+            error = start(token.kind == TokenKind::MappingStart);
+            break;
+        case TokenKind::End:
+            error = end();
+            break;
+        case TokenKind::Alias:
+            error = alias(token.offset);
+            break;
+        }
+
+        if (error != ParseError::None)
+            return error;
+    }
+    return ParseError::None;
+}
+
+// Collections as keys would have no text to write
+ParseError Transcoder::start(bool is_mapping)
+{
+    if (!m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key)
+        return ParseError::Unsupported;
+    if (exceeds(m_stack.size() + 1, m_limits.max_depth))
+        return ParseError::TooDeep;
+
+    beginValue();
+    writeStart(is_mapping);
+    m_stack.push_back(Frame{is_mapping, true, 0});
+    return ParseError::None;
+}
+
+ParseError Transcoder::end()
+{
+    if (m_stack.empty())
+        return ParseError::Syntax;
+
+    writeEnd(m_stack.back().is_mapping, m_stack.back().count);
+    m_stack.pop_back();
+    endValue();
+    return ParseError::None;
+}
+
+// Sequence items are counted and separated here, mapping entries by their key
+void Transcoder::beginValue()
+{
+    if (m_stack.empty() || m_stack.back().is_mapping)
+        return;
+
+    if (m_stack.back().count++ > 0)
+        writeSeparator();
+}
+
+void Transcoder::endValue()
+{
+    if (!m_stack.empty() && m_stack.back().is_mapping)
+        m_stack.back().expect_key = true;
+}
+
+void Transcoder::record(TokenKind kind, std::string_view text)
+{
+    m_tokens.push_back(Token{kind, m_text.size(), text.size()});
+    m_text.append(text);
+}
+
+// Later anchors of the same name replace earlier ones for the aliases that follow
+void Transcoder::anchor(const yaml_char_t* name, size_t first)
+{
+    m_anchor_names[(const char*)name] = m_anchors.size();
+    m_anchors.push_back(Anchor{first, m_tokens.size()});
+}
+
+void Transcoder::finishRecordings()
+{
+    while (!m_recordings.empty() && m_recordings.back().depth == m_stack.size()) {
+        Recording recording = std::move(m_recordings.back());
+        m_recordings.pop_back();
+
+        m_anchor_names[recording.name] = m_anchors.size();
+        m_anchors.push_back(Anchor{recording.first, m_tokens.size()});
+    }
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "EmbedYAML/ParseLimits.hpp"
+#include "EmbedYAML/YAMLStream.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace EmbedYAML {
+
+// A plain scalar read by the YAML 1.2 core schema, so "~" is null, "0x1F" is 31 and "yes"
+// stays a string
+struct ScalarValue {
+    enum class Type {
+        Null,
+        Bool,
+        Int,
+        UInt,       // Only above the range of Int
+        Float,
+        String
+    };
+
+    Type type = Type::String;
+    bool boolean = false;
+    int64_t integer = 0;
+    uint64_t unsigned_integer = 0;
+    double real = 0;
+};
+
+// Quoted scalars and those tagged as strings are passed as quoted and always read as strings
+ScalarValue resolveScalar(std::string_view text, bool quoted);
+
+// Turns parser events into another format without building a tree. Only anchored nodes are
+// kept, as the events needed to replay them for their aliases, and both are dropped at the
+// end of each document. Formats derive from this and write the nodes they are handed.
+class Transcoder {
+public:
+    explicit Transcoder(const ParseLimits& limits) : m_limits(limits) {}
+    virtual ~Transcoder() = default;
+
+    Transcoder(const Transcoder&) = delete;
+    Transcoder& operator=(const Transcoder&) = delete;
+
+    // Writes every document the reader yields. Keys that are collections, or aliases of
+    // collections, stop the transcoder with Unsupported.
+    ParseError run(YAMLEventReader& reader);
+
+protected:
+    // Keys are always text, count is the number of entries or items in the collection
+    virtual void writeKey(std::string_view text) = 0;
+    virtual void writeScalar(std::string_view text, bool quoted) = 0;
+    virtual void writeStart(bool is_mapping) = 0;
+    virtual void writeEnd(bool is_mapping, size_t count) = 0;
+
+    // Precedes every key and sequence item but the first of its collection
+    virtual void writeSeparator() {}
+    virtual void writeDocumentEnd() {}
+
+    // Checked at the end of every document, None while output can go on
+    virtual ParseError outputError() const = 0;
+
+private:
+    enum class TokenKind : uint8_t {
+        Scalar,
+        QuotedScalar,
+        MappingStart,
+        SequenceStart,
+        End,
+        Alias           // Replays the anchor at offset
+    };
+
+    struct Token {
+        TokenKind kind;
+        size_t offset;      // Text in m_text, or the anchor replayed
+        size_t length;
+    };
+
+    // Tokens of a complete anchored node
+    struct Anchor {
+        size_t first;
+        size_t last;
+    };
+
+    // An anchored collection still being recorded
+    struct Recording {
+        std::string name;
+        size_t first;
+        size_t depth;
+    };
+
+    struct Frame {
+        bool is_mapping;
+        bool expect_key;
+        size_t count;
+    };
+
+    ParseError document(YAMLEventReader& reader);
+    ParseError event(const yaml_event_t& event);
+
+    // A single node, shared by parser events and replayed anchors
+    ParseError scalar(std::string_view text, bool quoted);
+    ParseError alias(size_t anchor);
+    ParseError start(bool is_mapping);
+    ParseError end();
+    void beginValue();
+    void endValue();
+
+    void record(TokenKind kind, std::string_view text = std::string_view());
+    void anchor(const yaml_char_t* name, size_t first);
+    void finishRecordings();
+
+    ParseLimits m_limits;
+    std::vector<Frame> m_stack;
+
+    std::vector<Token> m_tokens;
+    std::string m_text;
+    std::vector<Anchor> m_anchors;
+    std::unordered_map<std::string, size_t> m_anchor_names;
+    std::vector<Recording> m_recordings;
+
+    size_t m_nodes = 0;
+    size_t m_scalar_bytes = 0;
+    size_t m_alias_expansions = 0;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,256 @@
+#include "Utf8.hpp"
+#include "CpuFeatures.hpp"
+#include <cstdint>
+
+namespace EmbedYAML {
+
+namespace {
+
+// Validates the character at p and moves past it
+bool validateCharacter(const unsigned char*& p, const unsigned char* end)
+{
+    unsigned char c = *p;
+
+    if (c < 0x80) {
+        if ((c < 0x20 && c != '\t' && c != '\n' && c != '\r') || c == 0x7F)
+            return false;
+        p++;
+        return true;
+    }
+
+    size_t width;
+    uint32_t value;
+    if ((c & 0xE0) == 0xC0) {
+        width = 2;
+        value = c & 0x1F;
+    } else if ((c & 0xF0) == 0xE0) {
+        width = 3;
+        value = c & 0x0F;
+    } else if ((c & 0xF8) == 0xF0) {
+        width = 4;
+        value = c & 0x07;
+    } else {
+        return false;
+    }
+
+    if ((size_t)(end - p) < width)
+        return false;
+
+    for (size_t i = 1; i < width; ++i) {
+        if ((p[i] & 0xC0) != 0x80)
+            return false;
+        value = (value << 6) | (p[i] & 0x3F);
+    }
+
+    // Overlong forms, surrogates and the non-printable ranges libyaml rejects
+    if ((width == 2 && value < 0x80) || (width == 3 && value < 0x800) || (width == 4 && value < 0x10000))
+        return false;
+    if (value > 0x10FFFF || (value >= 0xD800 && value <= 0xDFFF))
+        return false;
+    if (value < 0xA0 && value != 0x85)
+        return false;
+    if (value == 0xFFFE || value == 0xFFFF)
+        return false;
+
+    p += width;
+    return true;
+}
+
+// Clean blocks are printable ASCII, tab and line breaks only and need no decoding
+using CleanBlockFunction = bool (*)(const unsigned char* block);
+
+constexpr size_t BLOCK_SIZE = 32;
+
+bool cleanBlockPortable(const unsigned char* block)
+{
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        unsigned char c = block[i];
+        if (c >= 0x7F || (c < 0x20 && c != '\t' && c != '\n' && c != '\r'))
+            return false;
+    }
+    return true;
+}
+
+#ifdef EMBEDYAML_X86_KERNELS
+
+// Signed compares reject bytes with the high bit set along with the controls
+__attribute__((target("sse2")))
+bool cleanBlockSSE2(const unsigned char* block)
+{
+    const __m128i low = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+
+    __m128i bad = _mm_setzero_si128();
+    for (size_t i = 0; i < BLOCK_SIZE; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(block + i));
+        __m128i printable = _mm_andnot_si128(_mm_cmpeq_epi8(chunk, del), _mm_cmpgt_epi8(chunk, low));
+        __m128i breaks = _mm_or_si128(_mm_cmpeq_epi8(chunk, tab),
+                                      _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+        bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_or_si128(printable, breaks), _mm_set1_epi8(-1)));
+    }
+
+    return _mm_movemask_epi8(bad) == 0;
+}
+
+__attribute__((target("avx2")))
+bool cleanBlockAVX2(const unsigned char* block)
+{
+    __m256i chunk = _mm256_loadu_si256((const __m256i*)block);
+    __m256i printable = _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(0x7F)),
+                                            _mm256_cmpgt_epi8(chunk, _mm256_set1_epi8(0x1F)));
+    __m256i breaks = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t')),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+                                                     _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+
+    return (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(printable, breaks)) == 0xFFFFFFFFu;
+}
+
+#endif
+
+CleanBlockFunction selectKernel()
+{
+    switch (simdLevel())
+    {
+#ifdef EMBEDYAML_X86_KERNELS
+    case SimdLevel::AVX2:
+        return cleanBlockAVX2;
+    case SimdLevel::SSE2:
+        return cleanBlockSSE2;
+#endif
+    default:
+        return cleanBlockPortable;
+    }
+}
+
+} // namespace
+
+void appendUtf8(std::string& out, uint32_t value)
+{
+    if (value < 0x80) {
+        out += (char)value;
+    } else if (value < 0x800) {
+        out += (char)(0xC0 | (value >> 6));
+        out += (char)(0x80 | (value & 0x3F));
+    } else if (value < 0x10000) {
+        out += (char)(0xE0 | (value >> 12));
+        out += (char)(0x80 | ((value >> 6) & 0x3F));
+        out += (char)(0x80 | (value & 0x3F));
+    } else {
+        out += (char)(0xF0 | (value >> 18));
+        out += (char)(0x80 | ((value >> 12) & 0x3F));
+        out += (char)(0x80 | ((value >> 6) & 0x3F));
+        out += (char)(0x80 | (value & 0x3F));
+    }
+}
+
+size_t detectByteOrderMark(const char* data, size_t length, InputEncoding& encoding)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    encoding = InputEncoding::UTF8;
+
+    if (length >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF)
+        return 3;
+
+    if (length >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        encoding = InputEncoding::UTF16LE;
+        return 2;
+    }
+
+    if (length >= 2 && p[0] == 0xFE && p[1] == 0xFF) {
+        encoding = InputEncoding::UTF16BE;
+        return 2;
+    }
+
+    return 0;
+}
+
+bool transcodeUtf16(const char* data, size_t length, bool big_endian, std::string& out)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + (length & ~(size_t)1);
+
+    out.clear();
+    out.reserve(length);
+
+    while (p < end) {
+        uint32_t unit = big_endian ? (p[0] << 8 | p[1]) : (p[1] << 8 | p[0]);
+        p += 2;
+
+        if (unit >= 0xDC00 && unit <= 0xDFFF)
+            return false;
+
+        if (unit >= 0xD800 && unit <= 0xDBFF) {
+            if (p == end)
+                return false;
+
+            uint32_t low = big_endian ? (p[0] << 8 | p[1]) : (p[1] << 8 | p[0]);
+            if (low < 0xDC00 || low > 0xDFFF)
+                return false;
+
+            p += 2;
+            unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+        }
+
+        appendUtf8(out, unit);
+    }
+
+    return (length & 1) == 0;
+}
+
+bool validateInput(const char* data, size_t length)
+{
+    static const CleanBlockFunction clean_block = selectKernel();
+
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + length;
+
+    // Skip clean blocks in bulk and decode the rest a character at a time,
+    // a character straddling the block end simply pushes the next block along
+    while ((size_t)(end - p) >= BLOCK_SIZE) {
+        if (clean_block(p)) {
+            p += BLOCK_SIZE;
+            continue;
+        }
+
+        const unsigned char* stop = p + BLOCK_SIZE;
+        while (p < stop) {
+            if (!validateCharacter(p, end))
+                return false;
+        }
+    }
+
+    while (p < end) {
+        if (!validateCharacter(p, end))
+            return false;
+    }
+
+    return true;
+}
+
+bool prepareInput(const char*& data, size_t& length, std::string& storage)
+{
+    InputEncoding encoding;
+    size_t bom = detectByteOrderMark(data, length, encoding);
+
+    if (encoding != InputEncoding::UTF8) {
+        if (!transcodeUtf16(data + bom, length - bom, encoding == InputEncoding::UTF16BE, storage)
+            || !validateInput(storage.data(), storage.size()))
+            return false;
+
+        data = storage.data();
+        length = storage.size();
+        return true;
+    }
+
+    if (!validateInput(data + bom, length - bom))
+        return false;
+
+    data += bom;
+    length -= bom;
+    return true;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace EmbedYAML {
+
+enum class InputEncoding {
+    UTF8,
+    UTF16LE,
+    UTF16BE
+};
+
+// Appends a code point below 0x110000 encoded as UTF-8
+void appendUtf8(std::string& out, uint32_t value);
+
+// Detects a byte order mark, returning its length in bytes
+size_t detectByteOrderMark(const char* data, size_t length, InputEncoding& encoding);
+
+// Transcodes UTF-16 without its byte order mark, false on unpaired surrogates or odd lengths
+bool transcodeUtf16(const char* data, size_t length, bool big_endian, std::string& out);
+
+// True when the buffer is well-formed UTF-8 made of characters libyaml accepts
+// (tab, line breaks and printable code points), so later stages can skip those checks
+bool validateInput(const char* data, size_t length);
+
+// Normalises a buffer to validated UTF-8 without a byte order mark, transcoding UTF-16
+// into storage when needed. False when the input is malformed, data is then unchanged.
+bool prepareInput(const char*& data, size_t& length, std::string& storage);
+
+} // namespace EmbedYAML
@@ -0,0 +1,276 @@
+#include "EmbedYAML/YAMLEmitter.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace EmbedYAML {
+
+namespace {
+
+constexpr char SPACES[] = "                                ";
+
+bool isIndicator(char c)
+{
+    return std::strchr("-?:,[]{}#&*!|>'\"%@`", c) != nullptr;
+}
+
+bool needsEscape(unsigned char c)
+{
+    return c < 0x20 || c == 0x7F || c == '"' || c == '\\';
+}
+
+// NEL, LS and PS at i are line breaks to a reader, written as \N, \L and \P. Returns 0 otherwise.
+char unicodeBreak(std::string_view text, size_t i)
+{
+    if (text.compare(i, 2, "\xC2\x85") == 0)
+        return 'N';
+    if (text.compare(i, 3, "\xE2\x80\xA8") == 0)
+        return 'L';
+    if (text.compare(i, 3, "\xE2\x80\xA9") == 0)
+        return 'P';
+    return 0;
+}
+
+// Whether text reads back unchanged without quotes, anywhere a block-style scalar or key goes.
+// "-", "?" and ":" may only start plain text when a non-space follows, as in "-5".
+bool isPlain(std::string_view text)
+{
+    if (text.empty() || text[0] == ' ' || text.back() == ' ')
+        return false;
+    if (text.substr(0, 3) == "---" || text.substr(0, 3) == "...")
+        return false;
+
+    char first = text[0];
+    if (isIndicator(first)) {
+        bool may_start = (first == '-' || first == '?' || first == ':') && text.size() > 1 && text[1] != ' ';
+        if (!may_start)
+            return false;
+    }
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c < 0x20 || c == 0x7F || unicodeBreak(text, i))
+            return false;
+        if (c == ':' && (i + 1 == text.size() || text[i + 1] == ' '))
+            return false;
+        if (c == '#' && i > 0 && text[i - 1] == ' ')
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool YAMLEmitter::beginMapping()
+{
+    return beginCollection(true);
+}
+
+bool YAMLEmitter::beginSequence()
+{
+    return beginCollection(false);
+}
+
+bool YAMLEmitter::end()
+{
+    if (!ok())
+        return false;
+    if (m_stack.empty() || (m_stack.back().is_mapping && !m_stack.back().expect_key))
+        return fail(EmitError::BadEvent);
+
+    Frame frame = m_stack.back();
+    m_stack.pop_back();
+
+    if (!frame.opened) {
+        m_out.put(frame.after_key ? " " : "");
+        m_out.put(frame.is_mapping ? "{}\n" : "[]\n");
+        m_inline = false;
+    }
+    return ok();
+}
+
+bool YAMLEmitter::key(std::string_view text)
+{
+    if (!ok())
+        return false;
+    if (m_stack.empty() || !m_stack.back().is_mapping || !m_stack.back().expect_key)
+        return fail(EmitError::BadEvent);
+
+    Frame& top = m_stack.back();
+    open(top);
+    if (!m_inline)
+        putIndent(top.indent);
+    m_inline = false;
+
+    putScalar(text);
+    m_out.put(":");
+    top.expect_key = false;
+    return ok();
+}
+
+bool YAMLEmitter::scalar(std::string_view text)
+{
+    bool after_key = !m_stack.empty() && m_stack.back().is_mapping;
+    if (!beginValue())
+        return false;
+
+    m_out.put(after_key ? " " : "");
+    putScalar(text);
+    m_out.put("\n");
+    m_inline = false;
+    return ok();
+}
+
+bool YAMLEmitter::emit(const YAMLNode& node)
+{
+    bool needs_key = !m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key;
+    if (needs_key && !key(node.getKey()))
+        return false;
+
+    const YAMLNode& target = node.resolved();
+    if (target.isScalar())
+        return scalar(target.asScalar());
+
+    if (!beginCollection(target.isMapping()))
+        return false;
+    for (size_t i = 0; i < target.size(); ++i) {
+        if (!emit(target[i]))
+            return false;
+    }
+    return end();
+}
+
+bool YAMLEmitter::flush()
+{
+    return ok() && m_out.flush();
+}
+
+// Nothing is written until the first child, which decides between block style and {} or []
+bool YAMLEmitter::beginCollection(bool is_mapping)
+{
+    bool after_key = !m_stack.empty() && m_stack.back().is_mapping;
+    size_t indent = m_stack.empty() ? 0 : m_stack.back().indent + 2;
+    if (!beginValue())
+        return false;
+
+    m_stack.push_back(Frame{is_mapping, after_key, false, true, indent});
+    return true;
+}
+
+// Writes what precedes a value, "- " in a sequence or "---" before a later document
+bool YAMLEmitter::beginValue()
+{
+    if (!ok())
+        return false;
+
+    if (m_stack.empty()) {
+        if (m_started)
+            m_out.put("---\n");
+        m_started = true;
+        return ok();
+    }
+
+    Frame& top = m_stack.back();
+    if (top.is_mapping) {
+        if (top.expect_key)
+            return fail(EmitError::BadEvent);
+        top.expect_key = true;
+        return true;
+    }
+
+    open(top);
+    if (!m_inline)
+        putIndent(top.indent);
+    m_out.put("- ");
+    m_inline = true;
+    return ok();
+}
+
+// The first child of a collection under a key goes on the next line, one under "- "
+// continues that line
+void YAMLEmitter::open(Frame& frame)
+{
+    if (frame.opened)
+        return;
+
+    frame.opened = true;
+    if (frame.after_key) {
+        m_out.put("\n");
+        m_inline = false;
+    }
+}
+
+void YAMLEmitter::putIndent(size_t column)
+{
+    while (column > 0) {
+        size_t length = std::min(column, sizeof(SPACES) - 1);
+        m_out.put(std::string_view(SPACES, length));
+        column -= length;
+    }
+}
+
+// Text that would not read back as written is double-quoted, runs without escapes are
+// copied whole
+void YAMLEmitter::putScalar(std::string_view text)
+{
+    if (isPlain(text)) {
+        m_out.put(text);
+        return;
+    }
+
+    m_out.put("\"");
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (char letter = unicodeBreak(text, i)) {
+            char escape[2] = {'\\', letter};
+            m_out.put(text.substr(start, i - start));
+            m_out.put(std::string_view(escape, sizeof(escape)));
+            i += letter == 'N' ? 1 : 2;
+            start = i + 1;
+            continue;
+        }
+        if (!needsEscape(c))
+            continue;
+
+        m_out.put(text.substr(start, i - start));
+        start = i + 1;
+
+        switch (c)
+        {
+        case '"':
+            m_out.put("\\\"");
+            break;
+        case '\\':
+            m_out.put("\\\\");
+            break;
+        case '\n':
+            m_out.put("\\n");
+            break;
+        case '\t':
+            m_out.put("\\t");
+            break;
+        case '\r':
+            m_out.put("\\r");
+            break;
+        case '\0':
+            m_out.put("\\0");
+            break;
+        default: {
+            static const char HEX[] = "0123456789ABCDEF";
+            char escape[4] = {'\\', 'x', HEX[c >> 4], HEX[c & 0xF]};
+            m_out.put(std::string_view(escape, sizeof(escape)));
+            break;
+        }
+        }
+    }
+    m_out.put(text.substr(start));
+    m_out.put("\"");
+}
+
+bool YAMLEmitter::fail(EmitError error)
+{
+    m_error = error;
+    return false;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,283 @@
+#include "EmbedYAML/EmbedYAML.hpp"
+#include "InputScan.hpp"
+#include "ThreadPool.hpp"
+#include "Utf8.hpp"
+#include "YAMLTreeBuilder.hpp"
+#include <cstring>
+
+namespace EmbedYAML {
+
+namespace {
+
+// Builds the root of the next document, every document start is followed by one root node
+bool nextDocument(YAMLEventReader& reader, YAMLTreeBuilder& builder, YAMLNode& out)
+{
+    while (reader.next()) {
+        if (reader.type() != YAML_DOCUMENT_START_EVENT)
+            continue;
+
+        if (!reader.next()) {
+            builder.fail(reader.error());
+            return false;
+        }
+        if (!builder.run(reader))
+            return false;
+
+        out = std::move(builder.result());
+        return true;
+    }
+
+    builder.fail(reader.error());
+    return false;
+}
+
+// Document markers are found by byte scanning, which needs UTF-8 without a byte order mark.
+// Malformed input is kept as it is and libyaml reports the error per document.
+std::string normalizeInput(std::string input)
+{
+    const char* data = input.data();
+    size_t length = input.size();
+    std::string transcoded;
+
+    if (!prepareInput(data, length, transcoded))
+        return input;
+    if (!transcoded.empty())
+        return transcoded;
+
+    input.erase(0, data - input.data());
+    return input;
+}
+
+} // namespace
+
+YAMLSequenceStream::YAMLSequenceStream(EmbedYAML* ey, std::string filename, std::string key)
+    : m_reader(ey, std::move(filename)),
+      m_key(std::move(key)),
+      m_limits(ey->getParseOptions().limits)
+{
+}
+
+bool YAMLSequenceStream::fetch(YAMLNode& out)
+{
+    if (m_finished)
+        return false;
+
+    if (!m_positioned) {
+        m_positioned = true;
+        if (!seek()) {
+            m_finished = true;
+            if (m_error == ParseError::None)
+                m_error = m_reader.error();
+            return false;
+        }
+    }
+
+    if (!m_reader.next()) {
+        m_finished = true;
+        m_error = m_reader.error();
+        return false;
+    }
+    if (m_reader.type() == YAML_SEQUENCE_END_EVENT) {
+        m_finished = true;
+        return false;
+    }
+
+    // Limits apply to each item on its own
+    YAMLTreeBuilder builder(std::string(), m_limits, &m_anchors);
+    if (!builder.run(m_reader)) {
+        m_finished = true;
+        m_error = builder.error();
+        return false;
+    }
+
+    out = std::move(builder.result());
+    return true;
+}
+
+// Leaves the reader on the start event of the requested sequence
+bool YAMLSequenceStream::seek()
+{
+    if (!m_reader.isOpen()) {
+        m_error = m_reader.error() != ParseError::None ? m_reader.error() : ParseError::OpenFailed;
+        return false;
+    }
+
+    do {
+        if (!m_reader.next())
+            return false;
+    } while (m_reader.type() == YAML_STREAM_START_EVENT || m_reader.type() == YAML_DOCUMENT_START_EVENT);
+
+    if (m_key.empty())
+        return m_reader.type() == YAML_SEQUENCE_START_EVENT;
+
+    if (m_reader.type() != YAML_MAPPING_START_EVENT)
+        return false;
+
+    while (m_reader.next() && m_reader.type() != YAML_MAPPING_END_EVENT) {
+        const yaml_event_t& event = m_reader.event();
+        bool match = event.type == YAML_SCALAR_EVENT
+            && event.data.scalar.length == m_key.size()
+            && std::memcmp(event.data.scalar.value, m_key.data(), m_key.size()) == 0;
+
+        if (!skipValue() || !m_reader.next())
+            return false;
+
+        if (match && m_reader.type() == YAML_SEQUENCE_START_EVENT)
+            return true;
+
+        if (!skipValue())
+            return false;
+    }
+
+    return false;
+}
+
+// Skips the node at the current event like skipNode(), but builds the anchored
+// nodes inside it so that items can still refer to them
+bool YAMLSequenceStream::skipValue()
+{
+    size_t depth = 0;
+
+    for (;;) {
+        const yaml_event_t& event = m_reader.event();
+        const yaml_char_t* anchor = nullptr;
+
+        switch (event.type)
+        {
+        case YAML_SCALAR_EVENT:
+            anchor = event.data.scalar.anchor;
+            break;
+        case YAML_MAPPING_START_EVENT:
+            anchor = event.data.mapping_start.anchor;
+            break;
+        case YAML_SEQUENCE_START_EVENT:
+            anchor = event.data.sequence_start.anchor;
+            break;
+        default:
+            break;
+        }
+
+        if (anchor) {
+            YAMLTreeBuilder builder(std::string(), m_limits, &m_anchors);
+            if (!builder.run(m_reader)) {
+                m_error = builder.error();
+                return false;
+            }
+        } else if (event.type == YAML_MAPPING_START_EVENT || event.type == YAML_SEQUENCE_START_EVENT) {
+            depth++;
+        } else if (event.type == YAML_MAPPING_END_EVENT || event.type == YAML_SEQUENCE_END_EVENT) {
+            depth--;
+        }
+
+        if (depth == 0)
+            return true;
+        if (!m_reader.next())
+            return false;
+    }
+}
+
+YAMLDocumentStream::YAMLDocumentStream(EmbedYAML* ey, std::string filename)
+    : m_reader(ey, std::move(filename)),
+      m_limits(ey->getParseOptions().limits)
+{
+}
+
+bool YAMLDocumentStream::fetch(YAMLNode& out)
+{
+    if (m_finished)
+        return false;
+
+    if (!m_reader.isOpen()) {
+        m_finished = true;
+        m_error = m_reader.error() != ParseError::None ? m_reader.error() : ParseError::OpenFailed;
+        return false;
+    }
+
+    YAMLTreeBuilder builder("root", m_limits);
+    if (!nextDocument(m_reader, builder, out)) {
+        m_finished = true;
+        m_error = builder.error();
+        return false;
+    }
+
+    return true;
+}
+
+YAMLParallelDocumentStream::YAMLParallelDocumentStream(std::string input, unsigned threads, const ParseLimits& limits,
+                                                       ParseError read_error)
+    : m_input(normalizeInput(std::move(input))),
+      m_documents(findDocuments(m_input.data(), m_input.size())),
+      m_limits(limits),
+      m_pool(new ThreadPool(threads))
+{
+    // Keep enough documents in flight to occupy every worker without
+    // holding more than a couple of finished trees per thread
+    m_window = m_pool->size() * 2;
+
+    if (read_error != ParseError::None) {
+        m_error = read_error;
+        m_documents.clear();
+    } else if (m_limits.max_input_bytes && m_input.size() > m_limits.max_input_bytes) {
+        m_error = ParseError::InputTooLarge;
+        m_documents.clear();
+    }
+}
+
+YAMLParallelDocumentStream::~YAMLParallelDocumentStream()
+{
+}
+
+bool YAMLParallelDocumentStream::fetch(YAMLNode& out)
+{
+    if (m_error != ParseError::None)
+        return false;
+
+    schedule();
+
+    while (!m_pending.empty()) {
+        auto [document, error] = m_pending.front().get();
+        m_pending.pop_front();
+
+        // A malformed document or one over the limits ends the stream, later ones are not
+        // yielded, as when reading in order
+        if (error != ParseError::None) {
+            m_error = error;
+            return false;
+        }
+
+        schedule();
+
+        // Slices holding only comments or directives carry no document
+        if (document) {
+            out = std::move(*document);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void YAMLParallelDocumentStream::schedule()
+{
+    while (m_pending.size() < m_window && m_next_document < m_documents.size()) {
+        const char* data = m_input.data() + m_documents[m_next_document].first;
+        size_t length = m_documents[m_next_document].second - m_documents[m_next_document].first;
+        m_next_document++;
+
+        using Result = std::pair<std::optional<YAMLNode>, ParseError>;
+        auto task = std::make_shared<std::packaged_task<Result()>>(
+            [data, length, limits = m_limits]() -> Result {
+                YAMLEventReader reader(data, length);
+                YAMLTreeBuilder builder("root", limits);
+                YAMLNode document;
+                if (!nextDocument(reader, builder, document))
+                    return Result(std::nullopt, builder.error());
+                return Result(std::move(document), ParseError::None);
+            });
+
+        m_pending.push_back(task->get_future());
+        m_pool->submit([task] { (*task)(); });
+    }
+}
+
+} // namespace EmbedYAML
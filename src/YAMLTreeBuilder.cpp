@@ -0,0 +1,247 @@
+#include "YAMLTreeBuilder.hpp"
+
+namespace EmbedYAML {
+
+namespace {
+
+std::string anchorName(const yaml_char_t* anchor)
+{
+    return anchor ? std::string((const char*)anchor) : std::string();
+}
+
+bool exceeds(size_t value, size_t limit)
+{
+    return limit && value > limit;
+}
+
+} // namespace
+
+YAMLTreeBuilder::YAMLTreeBuilder(std::string key, const ParseLimits& limits, AnchorTable* anchors)
+    : m_root_key(std::move(key)),
+      m_limits(limits),
+      m_anchors(anchors ? anchors : &m_own_anchors)
+{
+}
+
+bool YAMLTreeBuilder::feed(const yaml_event_t& event)
+{
+    switch (event.type)
+    {
+    case YAML_SCALAR_EVENT:
+        return scalar(std::string((char*)event.data.scalar.value, event.data.scalar.length),
+                      anchorName(event.data.scalar.anchor));
+    case YAML_ALIAS_EVENT:
+        return alias(anchorName(event.data.alias.anchor));
+    case YAML_MAPPING_START_EVENT:
+        return mappingStart(anchorName(event.data.mapping_start.anchor));
+    case YAML_SEQUENCE_START_EVENT:
+        return sequenceStart(anchorName(event.data.sequence_start.anchor));
+    case YAML_MAPPING_END_EVENT:
+    case YAML_SEQUENCE_END_EVENT:
+        return collectionEnd();
+    default:
+        return false;
+    }
+}
+
+bool YAMLTreeBuilder::scalar(std::string value, std::string anchor)
+{
+    if (m_error != ParseError::None)
+        return true;
+    if (!countNode(value.size()))
+        return fail(m_error);
+    if (m_validator.enabled() && !m_validator.scalar(value))
+        return fail(ParseError::SchemaViolation);
+
+    if (!m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key) {
+        if (!anchor.empty())
+            (*m_anchors)[anchor] = Anchor{std::make_shared<const YAMLNode>(std::string(), value), 1};
+        m_stack.back().expanded++;
+        return setKey(std::move(value));
+    }
+
+    return complete(YAMLNode(takeKey(), std::move(value)), std::move(anchor), 1);
+}
+
+// Aliases share the anchored node, unknown anchors read as empty scalars
+bool YAMLTreeBuilder::alias(const std::string& anchor)
+{
+    if (m_error != ParseError::None)
+        return true;
+    if (!countNode(0))
+        return fail(m_error);
+
+    auto it = m_anchors->find(anchor);
+    size_t expanded = it != m_anchors->end() ? it->second.expanded : 1;
+
+    m_usage.alias_expansions += expanded;
+    if (exceeds(m_usage.alias_expansions, m_limits.max_alias_expansions))
+        return fail(ParseError::AliasExpansionsExceeded);
+    if (m_validator.enabled() && !m_validator.alias(it != m_anchors->end() ? it->second.node.get() : nullptr))
+        return fail(ParseError::SchemaViolation);
+
+    if (!m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key) {
+        bool scalar_key = it != m_anchors->end() && it->second.node->isScalar();
+        m_stack.back().expanded += expanded;
+        return setKey(scalar_key ? it->second.node->asScalar() : std::string());
+    }
+
+    if (it == m_anchors->end())
+        return complete(YAMLNode(takeKey(), std::string()), std::string(), expanded);
+
+    return complete(YAMLNode(takeKey(), it->second.node), std::string(), expanded);
+}
+
+bool YAMLTreeBuilder::mappingStart(std::string anchor)
+{
+    return startCollection(true, std::move(anchor));
+}
+
+bool YAMLTreeBuilder::sequenceStart(std::string anchor)
+{
+    return startCollection(false, std::move(anchor));
+}
+
+bool YAMLTreeBuilder::collectionEnd()
+{
+    if (m_stack.empty())
+        return false;
+
+    // Partial trees closed after an error are not checked
+    if (m_error == ParseError::None && m_validator.enabled() && !m_validator.end(&m_stack.back().node))
+        return fail(ParseError::SchemaViolation);
+
+    Frame frame = std::move(m_stack.back());
+    m_stack.pop_back();
+
+    if (frame.is_key) {
+        if (!frame.anchor.empty())
+            (*m_anchors)[frame.anchor] = Anchor{std::make_shared<const YAMLNode>(std::move(frame.node)), frame.expanded};
+        m_stack.back().key.clear();
+        m_stack.back().expect_key = false;
+        m_stack.back().expanded += frame.expanded;
+        return false;
+    }
+
+    frame.node.shrinkToFit();
+    return complete(std::move(frame.node), std::move(frame.anchor), frame.expanded);
+}
+
+void YAMLTreeBuilder::abandon()
+{
+    while (!m_stack.empty() && !collectionEnd()) {
+    }
+}
+
+void YAMLTreeBuilder::reset()
+{
+    m_stack.clear();
+    m_result = YAMLNode();
+    m_usage = ParseUsage();
+    m_error = ParseError::None;
+    m_own_anchors.clear();
+    m_validator.reset();
+}
+
+bool YAMLTreeBuilder::run(YAMLEventReader& reader)
+{
+    while (!feed(reader.event())) {
+        if (!reader.next()) {
+            fail(reader.error());
+            return false;
+        }
+    }
+
+    return m_error == ParseError::None;
+}
+
+bool YAMLTreeBuilder::build(YAMLEventReader& reader, YAMLNode& out, std::string key, AnchorTable* anchors)
+{
+    YAMLTreeBuilder builder(std::move(key), ParseLimits(), anchors);
+    bool complete = builder.run(reader);
+
+    out = std::move(builder.m_result);
+    return complete;
+}
+
+std::string YAMLTreeBuilder::takeKey()
+{
+    if (m_stack.empty())
+        return m_root_key;
+
+    Frame& top = m_stack.back();
+    if (!top.is_mapping || top.expect_key)
+        return std::string();
+
+    return std::move(top.key);
+}
+
+bool YAMLTreeBuilder::setKey(std::string key)
+{
+    m_stack.back().key = std::move(key);
+    m_stack.back().expect_key = false;
+    return false;
+}
+
+bool YAMLTreeBuilder::startCollection(bool is_mapping, std::string anchor)
+{
+    if (m_error != ParseError::None)
+        return true;
+    if (!countNode(0))
+        return fail(m_error);
+    if (exceeds(m_stack.size() + 1, m_limits.max_depth))
+        return fail(ParseError::TooDeep);
+    if (m_validator.enabled() && !m_validator.start(is_mapping))
+        return fail(ParseError::SchemaViolation);
+
+    bool is_key = !m_stack.empty() && m_stack.back().is_mapping && m_stack.back().expect_key;
+
+    YAMLNode node(takeKey(), is_mapping ? YAMLNode::Kind::Mapping : YAMLNode::Kind::Sequence);
+    m_stack.push_back(Frame{std::move(node), is_mapping, is_key, true, std::string(), std::move(anchor), 1});
+    return false;
+}
+
+bool YAMLTreeBuilder::complete(YAMLNode&& node, std::string anchor, size_t expanded)
+{
+    // The anchored node moves into shared storage and is referred to from its own position
+    if (!anchor.empty()) {
+        auto shared = std::make_shared<const YAMLNode>(std::move(node));
+        (*m_anchors)[anchor] = Anchor{shared, expanded};
+        node = YAMLNode(shared->getKey(), shared);
+    }
+
+    if (m_stack.empty()) {
+        m_result = std::move(node);
+        return true;
+    }
+
+    Frame& top = m_stack.back();
+    top.node.addNode(std::move(node));
+    top.expanded += expanded;
+    if (top.is_mapping)
+        top.expect_key = true;
+
+    return false;
+}
+
+bool YAMLTreeBuilder::countNode(size_t scalar_bytes)
+{
+    m_usage.nodes++;
+    m_usage.scalar_bytes += scalar_bytes;
+
+    if (exceeds(m_usage.nodes, m_limits.max_nodes))
+        m_error = ParseError::TooManyNodes;
+    else if (exceeds(m_usage.scalar_bytes, m_limits.max_scalar_bytes))
+        m_error = ParseError::ScalarBytesExceeded;
+
+    return m_error == ParseError::None;
+}
+
+bool YAMLTreeBuilder::fail(ParseError error)
+{
+    m_error = error;
+    abandon();
+    return true;
+}
+
+} // namespace EmbedYAML
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "EmbedYAML/ParseLimits.hpp"
+#include "EmbedYAML/YAMLStream.hpp"
+#include "SchemaValidator.hpp"
+#include <string>
+#include <vector>
+
+namespace EmbedYAML {
+
+// Work done by one builder, measured against the parse limits
+struct ParseUsage {
+    size_t nodes = 0;
+    size_t scalar_bytes = 0;
+    size_t alias_expansions = 0;
+};
+
+// Builds a single YAMLNode from a sequence of parse events. Anchored nodes are moved
+// into shared subtrees that every later alias refers to, anchors are recorded in the
+// given table or in one private to the builder.
+class YAMLTreeBuilder {
+public:
+    explicit YAMLTreeBuilder(std::string key, const ParseLimits& limits = ParseLimits(), AnchorTable* anchors = nullptr);
+
+    YAMLTreeBuilder(const YAMLTreeBuilder&) = delete;
+    YAMLTreeBuilder& operator=(const YAMLTreeBuilder&) = delete;
+
+    // Each call returns true once the top-level node is complete or a limit was exceeded
+    bool feed(const yaml_event_t& event);
+    bool scalar(std::string value, std::string anchor = std::string());
+    bool alias(const std::string& anchor);
+    bool mappingStart(std::string anchor = std::string());
+    bool sequenceStart(std::string anchor = std::string());
+    bool collectionEnd();
+
+    // Closes any open collections so a partial tree can still be returned
+    void abandon();
+
+    // Checks every event against schema, stopping with SchemaViolation at the first node
+    // that breaks it. The schema must outlive the builder, null checks nothing.
+    void setSchema(const Schema* schema) { m_validator.setSchema(schema); }
+    const SchemaReport& schemaReport() const { return m_validator.report(); }
+
+    // Starts over for another node, keeping the limits, the schema and the anchor table
+    void reset();
+
+    // Feeds events from the reader's current one on, false on a parser error or a limit
+    bool run(YAMLEventReader& reader);
+
+    // Stops with an error and closes the partial tree, always returns true
+    bool fail(ParseError error);
+
+    YAMLNode& result() { return m_result; }
+    ParseError error() const { return m_error; }
+    const ParseUsage& usage() const { return m_usage; }
+
+    // Builds the node starting at the reader's current event
+    static bool build(YAMLEventReader& reader, YAMLNode& out, std::string key, AnchorTable* anchors = nullptr);
+
+private:
+    struct Frame {
+        YAMLNode node;
+        bool is_mapping;
+        bool is_key;       // Complex mapping key, discarded once complete
+        bool expect_key;
+        std::string key;
+        std::string anchor;
+        size_t expanded;   // Nodes in the subtree with aliases expanded
+    };
+
+    std::string takeKey();
+    bool setKey(std::string key);
+    bool startCollection(bool is_mapping, std::string anchor);
+    bool complete(YAMLNode&& node, std::string anchor, size_t expanded);
+    bool countNode(size_t scalar_bytes);
+
+    std::vector<Frame> m_stack;
+    std::string m_root_key;
+    YAMLNode m_result;
+    ParseLimits m_limits;
+    ParseUsage m_usage;
+    ParseError m_error = ParseError::None;
+    AnchorTable m_own_anchors;
+    AnchorTable* m_anchors;
+    SchemaValidator m_validator;
+};
+
+} // namespace EmbedYAML
@@ -0,0 +1,230 @@
+// Differential test of the native scanner against libyaml. Random block documents are
+// built from pieces that exercise the scanner's subset and the syntax around its edges,
+// such as tabs after indicators and NEL, LS and PS inside scalars.
+// Every document the scanner accepts has to give the same tree libyaml builds, and
+// libyaml has to accept it as well. Documents the scanner leaves to libyaml are skipped.
+//
+// Usage: embedyaml-native-scanner-diff [documents] [seed]
+
+#include "NativeScanner.hpp"
+#include "YAMLTreeBuilder.hpp"
+#include <EmbedYAML/YAMLStream.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+namespace {
+
+const char* const KEYS[] = {"a", "b c", "\"q\"", "'s'", "x:y", "-n", "k#", "?", "&a", "\"e\\n\"", "a ", "t\tt"};
+const char* const VALUES[] = {"", "1", "v v", "\"d\\\"q\"", "'x'", "a # c", "-1", "~", "[x]", "b: c", " ", "'a''b'",
+                              "\"\\x41\"", "x:", "#c", "\"bad\\q\"", "- z", "\tt", "b\xC2\x85" "c", "'x\xE2\x80\xA8y'"};
+const char* const SEPARATORS[] = {" ", " ", " ", " ", "  ", "\t", " \t"};
+const char* const BLOCK_HEADERS[] = {"|", ">", "|-", ">+", "|2", ">1-", "|+", ">-", "| # c", "|x", ">2", "|0", "|1"};
+const char* const BLOCK_LINES[] = {"text", "more text", " lead", "\ttab", "a: b", "- x", "# not comment", "\"q\\n\"",
+                                   "x \\ y", "", "end  ", "n\xC2\x85" "el"};
+const char* const NESTED_KEYS[] = {"a", "b", "c d", "'q'", "\"k\\tk\"", "caf\xC3\xA9", "-n"};
+const char* const SCALARS[] = {"a", "b c", "-1", "0x1F", "x:y", "~", "true", "caf\xC3\xA9", "a\tb", "\"d\\tq\"", "'a''b'",
+                               "\"\\N\"", "\"\\u00e9\"", "t # c"};
+const char* const HAZARDS[] = {"\tt", "n\xC2\x85" "el", "'l\xE2\x80\xA8s'", "\"p\xE2\x80\xA9s\"", "- \tx", "-\tx"};
+
+template <typename T, size_t N>
+const T& pick(std::mt19937& random, const T (&items)[N])
+{
+    return items[random() % N];
+}
+
+// Mappings, sequences, compact items, comments and flow or anchor syntax the scanner rejects
+std::string blockDocument(std::mt19937& random)
+{
+    std::string text;
+    int lines = random() % 6 + 1;
+    for (int i = 0; i < lines; ++i) {
+        int indent = (random() % 4) * 2 - (random() % 5 == 0);
+        text.append(indent > 0 ? indent : 0, ' ');
+
+        switch (random() % 6)
+        {
+        case 0:
+        case 1:
+            text += pick(random, KEYS);
+            text += ":";
+            if (random() % 2)
+                text += std::string(pick(random, SEPARATORS)) + pick(random, VALUES);
+            break;
+        case 2:
+            text += "-";
+            if (random() % 3)
+                text += std::string(pick(random, SEPARATORS)) + pick(random, VALUES);
+            break;
+        case 3:
+            text += std::string("- ") + pick(random, KEYS) + ": " + pick(random, VALUES);
+            break;
+        case 4:
+            text += "# comment";
+            break;
+        default:
+            text += pick(random, VALUES);
+            break;
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+// Literal and folded scalars with every kind of header, indentation and line break
+std::string blockScalarDocument(std::mt19937& random)
+{
+    std::string text;
+    int lines = random() % 8 + 1;
+    for (int i = 0; i < lines; ++i) {
+        text.append(random() % 6, ' ');
+
+        switch (random() % 4)
+        {
+        case 0:
+            text += random() % 2 ? "- " : "k: ";
+            text += pick(random, BLOCK_HEADERS);
+            break;
+        case 1:
+            if (random() % 3 == 0)
+                break;
+            [[fallthrough]];
+        default:
+            text += pick(random, BLOCK_LINES);
+            break;
+        }
+        text += random() % 10 == 0 ? "\r\n" : "\n";
+    }
+    if (random() % 5 == 0)
+        text.pop_back();
+    return text;
+}
+
+// Well indented mappings and sequences inside the scanner's subset, now and then with a
+// value the scanner has to leave to libyaml
+void nestedNode(std::mt19937& random, std::string& text, size_t indent, int depth, bool mapping)
+{
+    int entries = random() % 4 + 1;
+    for (int i = 0; i < entries; ++i) {
+        text.append(indent, ' ');
+        text += mapping ? std::string(pick(random, NESTED_KEYS)) + ":" : std::string("-");
+
+        if (depth < 3 && random() % 3 == 0) {
+            // Sequences may share the indentation of their mapping key
+            bool child_mapping = random() % 2;
+            size_t child_indent = mapping && !child_mapping && random() % 2 ? indent : indent + 2;
+            text += "\n";
+            nestedNode(random, text, child_indent, depth + 1, child_mapping);
+        } else {
+            text += " ";
+            text += random() % 16 ? pick(random, SCALARS) : pick(random, HAZARDS);
+            text += "\n";
+        }
+    }
+}
+
+std::string nestedDocument(std::mt19937& random)
+{
+    std::string text;
+    nestedNode(random, text, 0, 0, random() % 4 != 0);
+    return text;
+}
+
+bool sameTree(const YAMLNode& native, const YAMLNode& reference)
+{
+    const YAMLNode& left = native.resolved();
+    const YAMLNode& right = reference.resolved();
+    if (left.getKey() != right.getKey() || left.getKind() != right.getKind())
+        return false;
+    if (left.isScalar())
+        return left.asScalar() == right.asScalar();
+    if (left.size() != right.size())
+        return false;
+
+    for (size_t i = 0; i < left.size(); ++i) {
+        if (!sameTree(left[i], right[i]))
+            return false;
+    }
+    return true;
+}
+
+// Builds the first document with libyaml, which also has to accept the rest of it
+bool parseReference(const std::string& text, YAMLNode& root, bool& found)
+{
+    found = false;
+    EmbedYAML::YAMLEventReader reader(text.data(), text.size());
+    while (reader.next()) {
+        if (reader.type() == YAML_STREAM_START_EVENT || reader.type() == YAML_DOCUMENT_START_EVENT)
+            continue;
+        if (reader.type() == YAML_STREAM_END_EVENT)
+            return true;
+
+        found = true;
+        if (!EmbedYAML::YAMLTreeBuilder::build(reader, root, "root"))
+            return false;
+        while (reader.next() && reader.type() != YAML_DOCUMENT_END_EVENT) {
+        }
+        return !reader.failed();
+    }
+    return false;
+}
+
+enum class Outcome {
+    Skipped,
+    Matched,
+    Mismatched
+};
+
+Outcome compare(const std::string& text)
+{
+    EmbedYAML::YAMLTreeBuilder builder("root");
+    EmbedYAML::NativeResult result = EmbedYAML::parseNative(text.data(), text.size(), builder);
+    if (result == EmbedYAML::NativeResult::Unsupported)
+        return Outcome::Skipped;
+
+    YAMLNode reference("root");
+    bool found;
+    if (!parseReference(text, reference, found))
+        return Outcome::Mismatched;
+
+    if (result == EmbedYAML::NativeResult::Empty)
+        return found ? Outcome::Mismatched : Outcome::Matched;
+    return found && sameTree(builder.result(), reference) ? Outcome::Matched : Outcome::Mismatched;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    unsigned long documents = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    std::mt19937 random(argc > 2 ? (unsigned)std::strtoul(argv[2], nullptr, 10) : 1);
+
+    unsigned long counts[3] = {};
+    for (unsigned long i = 0; i < documents; ++i) {
+        std::string text;
+        switch (i % 3)
+        {
+        case 0:
+            text = blockDocument(random);
+            break;
+        case 1:
+            text = blockScalarDocument(random);
+            break;
+        default:
+            text = nestedDocument(random);
+            break;
+        }
+
+        Outcome outcome = compare(text);
+        counts[(int)outcome]++;
+
+        // The first few are enough to reproduce a bug
+        if (outcome == Outcome::Mismatched && counts[(int)Outcome::Mismatched] <= 3)
+            std::printf("Mismatch on document %lu:\n%s\n---\n", i, text.c_str());
+    }
+
+    std::printf("%lu documents: %lu matched, %lu left to libyaml, %lu mismatched\n", documents,
+                counts[(int)Outcome::Matched], counts[(int)Outcome::Skipped], counts[(int)Outcome::Mismatched]);
+    return counts[(int)Outcome::Mismatched] ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,100 @@
+// Checks that both schema validators read "<<" merges the way lookups do: merged keys count
+// as the mapping's own, keys written in the mapping override them and "<<" itself is never
+// an unknown key. Schema::validate() checks the built tree, ParseOptions::schema the events.
+
+#include <EmbedYAML/EmbedYAML.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const SCHEMA =
+    "type: mapping\n"
+    "properties:\n"
+    "  base: {type: any}\n"
+    "  other: {type: any}\n"
+    "  dev:\n"
+    "    type: mapping\n"
+    "    required: [rate, name]\n"
+    "    additional_properties: false\n"
+    "    max_size: 3\n"
+    "    properties:\n"
+    "      rate: {type: integer, maximum: 10}\n"
+    "      name: {type: string}\n"
+    "      extra: {type: string}\n";
+
+struct Case {
+    const char* document;
+    EmbedYAML::SchemaViolation violation;
+    const char* path;
+};
+
+const Case CASES[] = {
+    {"base: &b {rate: 5, name: x}\ndev:\n  <<: *b\n", EmbedYAML::SchemaViolation::None, ""},
+    {"dev:\n  <<: {rate: 5, name: x}\n", EmbedYAML::SchemaViolation::None, ""},
+    {"base: &b {rate: 5}\nother: &o {rate: 50, name: y}\ndev:\n  <<: [*b, *o]\n", EmbedYAML::SchemaViolation::None, ""},
+    {"base: &b {<<: {rate: 5}, name: x}\ndev:\n  <<: *b\n", EmbedYAML::SchemaViolation::None, ""},
+    {"base: &b {rate: 50, name: x}\ndev:\n  <<: *b\n  rate: 1\n", EmbedYAML::SchemaViolation::None, ""},
+    {"base: &b {rate: 50, name: x}\ndev:\n  rate: 1\n  <<: *b\n", EmbedYAML::SchemaViolation::None, ""},
+    {"base: &b {rate: 50, name: x}\ndev:\n  <<: *b\n", EmbedYAML::SchemaViolation::OutOfRange, "dev.rate"},
+    {"base: &b {rate: 5}\ndev:\n  <<: *b\n", EmbedYAML::SchemaViolation::MissingKey, "dev.name"},
+    {"base: &b {rate: 5, name: x, zz: 1}\ndev:\n  <<: *b\n", EmbedYAML::SchemaViolation::UnknownKey, "dev.zz"},
+    {"base: &b {rate: 5, name: x}\ndev:\n  <<: *b\n  zz: f\n", EmbedYAML::SchemaViolation::UnknownKey, "dev.zz"},
+};
+
+// Only buffers are read, so the file callbacks are never called
+EmbedYAML::EmbedYAML makeParser()
+{
+    return EmbedYAML::EmbedYAML(
+        [](EmbedYAML::EmbedYAML*, std::string) { return -1; },
+        [](EmbedYAML::EmbedYAML*, std::string) { return 0; },
+        [](EmbedYAML::EmbedYAML*) -> std::optional<char> { return std::nullopt; });
+}
+
+bool expect(const char* validator, const Case& test, const EmbedYAML::SchemaReport& report)
+{
+    if (report.violation == test.violation && report.path == test.path)
+        return true;
+
+    std::printf("%s validator gave %d at \"%s\" for:\n%s\n", validator, (int)report.violation, report.path.c_str(),
+                test.document);
+    return false;
+}
+
+} // namespace
+
+int main()
+{
+    EmbedYAML::EmbedYAML ey = makeParser();
+    YAMLNode definition = ey.parseBuffer(SCHEMA, std::string(SCHEMA).size());
+    auto schema = std::make_shared<EmbedYAML::Schema>(definition);
+    if (!schema->valid()) {
+        std::printf("Schema does not compile\n");
+        return EXIT_FAILURE;
+    }
+
+    EmbedYAML::ParseOptions streaming;
+    streaming.schema = schema;
+
+    int failures = 0;
+    for (const Case& test : CASES) {
+        std::string document = test.document;
+
+        ey.setParseOptions(EmbedYAML::ParseOptions());
+        YAMLNode root = ey.parseBuffer(document.data(), document.size());
+        std::vector<EmbedYAML::SchemaReport> reports = schema->validate(root, 2);
+        if (!expect("Tree", test, reports.empty() ? EmbedYAML::SchemaReport() : reports.front()))
+            failures++;
+
+        ey.setParseOptions(streaming);
+        ey.parseBuffer(document.data(), document.size());
+        if (!expect("Streaming", test, ey.getLastSchemaReport()))
+            failures++;
+    }
+
+    std::printf("%zu documents, %d failures\n", sizeof(CASES) / sizeof(CASES[0]), failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+// Precompiles a YAML file into the binary document format loaded by BinaryDocument, or
+// into a header defining the document as constant data for embedyaml_compile(), or
+// transcodes it to CBOR or MessagePack
+//
+// Usage: embedyaml-convert <input.yaml> <output.eyb>
+//        embedyaml-convert --header <namespace> <input.yaml> <output.hpp>
+//        embedyaml-convert --cbor|--msgpack <input.yaml> <output>
+
+#include <EmbedYAML/BinaryDocument.hpp>
+#include <EmbedYAML/EmbedYAML.hpp>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+bool readInput(const char* filename, std::string& text)
+{
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+        std::fprintf(stderr, "Cannot open %s\n", filename);
+        return false;
+    }
+    text.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Only buffers are read, so the file callbacks are never called
+EmbedYAML::EmbedYAML makeParser()
+{
+    return EmbedYAML::EmbedYAML(
+        [](EmbedYAML::EmbedYAML*, std::string) { return -1; },
+        [](EmbedYAML::EmbedYAML*, std::string) { return 0; },
+        [](EmbedYAML::EmbedYAML*) -> std::optional<char> { return std::nullopt; });
+}
+
+bool compile(const char* filename, std::vector<unsigned char>& document)
+{
+    std::string text;
+    if (!readInput(filename, text))
+        return false;
+
+    EmbedYAML::EmbedYAML ey = makeParser();
+    YAMLNode root = ey.parseBuffer(text.data(), text.size());
+    if (ey.getLastError() != EmbedYAML::ParseError::None) {
+        std::fprintf(stderr, "%s: parse error %d\n", filename, (int)ey.getLastError());
+        return false;
+    }
+
+    if (EmbedYAML::BinaryDocument::write(root, document) != EmbedYAML::BinaryError::None) {
+        std::fprintf(stderr, "%s: too large for the binary format\n", filename);
+        return false;
+    }
+
+    return true;
+}
+
+bool transcode(const char* filename, EmbedYAML::CompactFormat format, std::vector<unsigned char>& out)
+{
+    std::string text;
+    if (!readInput(filename, text))
+        return false;
+
+    EmbedYAML::EmbedYAML ey = makeParser();
+    EmbedYAML::BlockWriter writer([&out](const char* data, size_t length) {
+        out.insert(out.end(), data, data + length);
+        return 0;
+    });
+
+    if (!ey.transcodeCompactBuffer(text.data(), text.size(), format, writer)) {
+        std::fprintf(stderr, "%s: transcode error %d\n", filename, (int)ey.getLastError());
+        return false;
+    }
+
+    return true;
+}
+
+std::string header(const std::vector<unsigned char>& document, const std::string& name, const std::string& source)
+{
+    std::string out;
+    out += "// Generated by embedyaml-convert from " + source.substr(source.find_last_of("/\\") + 1) + ", do not edit\n";
+    out += "#pragma once\n\n#include <EmbedYAML/BinaryDocument.hpp>\n\n";
+    out += "namespace " + name + " {\n\n";
+    out += "inline constexpr unsigned char data[] = {";
+
+    char byte[8];
+    for (size_t i = 0; i < document.size(); ++i) {
+        out += i % 16 ? " " : "\n    ";
+        std::snprintf(byte, sizeof(byte), "0x%02x,", document[i]);
+        out += byte;
+    }
+
+    out += "\n};\n\n";
+    out += "inline constexpr EmbedYAML::BinaryDocument document = EmbedYAML::BinaryDocument::trusted(data);\n\n";
+    out += "} // namespace " + name + "\n";
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool as_header = argc == 5 && std::strcmp(argv[1], "--header") == 0;
+    bool as_cbor = argc == 4 && std::strcmp(argv[1], "--cbor") == 0;
+    bool as_msgpack = argc == 4 && std::strcmp(argv[1], "--msgpack") == 0;
+    if (argc != 3 && !as_header && !as_cbor && !as_msgpack) {
+        std::fprintf(stderr, "Usage: %s <input.yaml> <output.eyb>\n", argv[0]);
+        std::fprintf(stderr, "       %s --header <namespace> <input.yaml> <output.hpp>\n", argv[0]);
+        std::fprintf(stderr, "       %s --cbor|--msgpack <input.yaml> <output>\n", argv[0]);
+        return 2;
+    }
+
+    const char* input = argv[argc - 2];
+    const char* output = argv[argc - 1];
+
+    std::vector<unsigned char> document;
+    if (as_cbor || as_msgpack) {
+        auto format = as_cbor ? EmbedYAML::CompactFormat::CBOR : EmbedYAML::CompactFormat::MessagePack;
+        if (!transcode(input, format, document))
+            return 1;
+    } else if (!compile(input, document)) {
+        return 1;
+    }
+
+    std::ofstream file(output, std::ios::binary);
+    if (as_header) {
+        std::string text = header(document, argv[2], input);
+        file.write(text.data(), (std::streamsize)text.size());
+    } else {
+        file.write((const char*)document.data(), (std::streamsize)document.size());
+    }
+
+    if (!file) {
+        std::fprintf(stderr, "Cannot write %s\n", output);
+        return 1;
+    }
+
+    return 0;
+}